@@ -3,19 +3,87 @@
 #include <string.h>
 
 #include "API.h"
+#include "Protocol.h"
+#include "Stats.h"
 
 #define BUFFER_SIZE 32
-
+#define COMMAND_SIZE 256
+#define MAX_QUEUED_MOTIONS 64
+
+// A command line composed ahead of time, newline included.
+typedef struct {
+    const char* text;
+    int length;
+    StatsCommandKind kind;
+} Command;
+
+#define COMMAND(name, kind) {name "\n", (int)sizeof(name), kind}
+
+static const Command MAZE_WIDTH = COMMAND("mazeWidth", STATS_COMMAND_OTHER);
+static const Command MAZE_HEIGHT = COMMAND("mazeHeight", STATS_COMMAND_OTHER);
+static const Command WALL_FRONT = COMMAND("wallFront", STATS_COMMAND_SENSE);
+static const Command WALL_RIGHT = COMMAND("wallRight", STATS_COMMAND_SENSE);
+static const Command WALL_LEFT = COMMAND("wallLeft", STATS_COMMAND_SENSE);
+static const Command WAS_RESET = COMMAND("wasReset", STATS_COMMAND_SENSE);
+static const Command ACK_RESET = COMMAND("ackReset", STATS_COMMAND_OTHER);
+static const Command MOVE_FORWARD = COMMAND("moveForward", STATS_COMMAND_MOVE);
+static const Command MOVE_FORWARD_HALF = COMMAND("moveForwardHalf", STATS_COMMAND_MOVE);
+static const Command TURN_RIGHT = COMMAND("turnRight", STATS_COMMAND_TURN);
+static const Command TURN_LEFT = COMMAND("turnLeft", STATS_COMMAND_TURN);
+static const Command TURN_RIGHT_45 = COMMAND("turnRight45", STATS_COMMAND_TURN);
+static const Command TURN_LEFT_45 = COMMAND("turnLeft45", STATS_COMMAND_TURN);
+static const Command CLEAR_ALL_COLOR = COMMAND("clearAllColor", STATS_COMMAND_DRAW);
+static const Command CLEAR_ALL_TEXT = COMMAND("clearAllText", STATS_COMMAND_DRAW);
+
+// A command with arguments, built up in place.
+typedef struct {
+    char text[COMMAND_SIZE];
+    int length;
+} CommandLine;
+
+typedef enum {
+    MOTION_MOVE = 0,  // amount half cells forward
+    MOTION_TURN       // amount eighths of a turn clockwise
+} MotionKind;
+
+typedef struct {
+    MotionKind kind;
+    int amount;
+} QueuedMotion;
+
+// The pose is tracked in half cells and eighths of a turn so that 45 degree
+// runs can be followed; cell centres are at odd half-cell coordinates.
 static int trackingInitialized = 0;
-static int mouseX = 0;
-static int mouseY = 0;
-static API_Direction mouseHeading = API_DIR_NORTH;
+static int halfX = 1;
+static int halfY = 1;
+static int heading8 = 0;
+// Set when a move of more than one cell crashes: the simulator stops it at
+// the wall, which may be any number of cells along, so the tracked position
+// means nothing until tracking is started again.
+static int poseLost = 0;
+// Motion commands sent but not yet answered, oldest first. The simulator
+// runs every one of them even after a crash, so tracking applies each
+// answer in turn; API_receiveQueued reports whether any crashed.
+static QueuedMotion queuedMotions[MAX_QUEUED_MOTIONS];
+static int queuedCount = 0;
+static int queuedCrashed = 0;
+static int outputInitialized = 0;
+// Optional protocol trace, one line per command (">") or response ("<"),
+// each prefixed with microseconds since the trace was opened. Display
+// commands are left out; they get no response and do not steer the run.
+static FILE* traceFile = NULL;
+static double traceStarted = 0.0;
 
 static void logMessage(const char* text) {
+#ifndef HEADLESS
     fprintf(stderr, "%s\n", text);
     fflush(stderr);
+#else
+    (void)text;
+#endif
 }
 
+#ifndef HEADLESS
 static const char* headingToString(API_Direction direction) {
     switch (direction) {
         case API_DIR_NORTH:
@@ -29,192 +97,476 @@ static const char* headingToString(API_Direction direction) {
     }
     return "unknown";
 }
+#endif
 
 static void publishPosition(void) {
-    if (!trackingInitialized) {
+#ifndef HEADLESS
+    if (!trackingInitialized || !(halfX & 1) || !(halfY & 1)) {
         return;
     }
     char buffer[32];
-    snprintf(buffer, sizeof(buffer), "%d,%d", mouseX, mouseY);
-    API_setText(mouseX, mouseY, buffer);
+    snprintf(buffer, sizeof(buffer), "%d,%d", API_mouseX(), API_mouseY());
+    API_setText(API_mouseX(), API_mouseY(), buffer);
+#endif
 }
 
-static void updatePosition(void) {
-    switch (mouseHeading) {
-        case API_DIR_NORTH:
-            mouseY += 1;
-            break;
-        case API_DIR_EAST:
-            mouseX += 1;
-            break;
-        case API_DIR_SOUTH:
-            mouseY -= 1;
-            break;
-        case API_DIR_WEST:
-            mouseX -= 1;
-            break;
+static void updatePosition(int halfSteps) {
+    static const int DELTA_X[8] = {0, 1, 1, 1, 0, -1, -1, -1};
+    static const int DELTA_Y[8] = {1, 1, 0, -1, -1, -1, 0, 1};
+    halfX += DELTA_X[heading8] * halfSteps;
+    halfY += DELTA_Y[heading8] * halfSteps;
+}
+
+// Opens $MMS_TRACE_FILE, if set, for tools/Replay.c to feed back later.
+static void initTrace(void) {
+    const char* path = getenv("MMS_TRACE_FILE");
+    if (path == NULL || path[0] == '\0') {
+        return;
+    }
+    traceFile = fopen(path, "w");
+    if (traceFile == NULL) {
+        logMessage("Unable to open trace file");
+        return;
+    }
+    traceStarted = Stats_now();
+    fprintf(traceFile, "#mms-trace 1\n");
+}
+
+static void traceLine(char direction, const char* text, int length) {
+    if (traceFile == NULL) {
+        return;
+    }
+    while (length > 0 && text[length - 1] == '\n') {
+        length -= 1;
     }
+    long micros = (long)((Stats_now() - traceStarted) * 1e6);
+    fprintf(traceFile, "%c%ld %.*s\n", direction, micros, length, text);
 }
 
-int getInteger(char* command) {
-    printf("%s\n", command);
-    fflush(stdout);
-    char response[BUFFER_SIZE];
-    fgets(response, BUFFER_SIZE, stdin);
-    int value = atoi(response);
+// Output-only commands collect in Protocol.c's buffer and reach the
+// simulator with the next query, an explicit API_flush() or process exit.
+static void initOutput(void) {
+    if (outputInitialized) {
+        return;
+    }
+    outputInitialized = 1;
+    atexit(API_flush);
+    initTrace();
+}
+
+static void sendText(const char* text, int length, StatsCommandKind kind) {
+    initOutput();
+    Stats_countCommandKind(kind, length);
+    if (kind != STATS_COMMAND_DRAW) {
+        traceLine('>', text, length);
+    }
+    Protocol_write(text, length);
+}
+
+static void sendCommand(const Command* command) {
+    sendText(command->text, command->length, command->kind);
+}
+
+static void beginLine(CommandLine* line, const Command* name) {
+    // The name without its newline.
+    memcpy(line->text, name->text, name->length - 1);
+    line->length = name->length - 1;
+}
+
+static void putChar(CommandLine* line, char c) {
+    if (line->length < COMMAND_SIZE - 1) {
+        line->text[line->length++] = c;
+    }
+}
+
+static void putInteger(CommandLine* line, int value) {
+    putChar(line, ' ');
+    if (line->length <= COMMAND_SIZE - 12) {
+        line->length += Protocol_formatInteger(value, line->text + line->length);
+    }
+}
+
+static void putString(CommandLine* line, const char* text) {
+    putChar(line, ' ');
+    while (*text != '\0' && line->length < COMMAND_SIZE - 1) {
+        line->text[line->length++] = *text++;
+    }
+}
+
+static void sendLine(CommandLine* line, StatsCommandKind kind) {
+    line->text[line->length++] = '\n';
+    sendText(line->text, line->length, kind);
+}
+
+static void sendQuery(const Command* command) {
+    sendCommand(command);
+    API_flush();
+}
+
+// Tracing and read-wait timing for a response the caller is about to parse.
+static double beginRead(void) {
+    return Stats_now();
+}
+
+static void endRead(double started) {
+    Stats_addReadWait(Stats_now() - started);
+    if (traceFile != NULL) {
+        char response[BUFFER_SIZE];
+        int length = Protocol_lastLine(response, sizeof(response));
+        traceLine('<', response, length);
+    }
+}
+
+static int readInteger(void) {
+    double started = beginRead();
+    int value = Protocol_readInteger();
+    endRead(started);
     return value;
 }
 
-int getBoolean(char* command) {
-    printf("%s\n", command);
-    fflush(stdout);
-    char response[BUFFER_SIZE];
-    fgets(response, BUFFER_SIZE, stdin);
-    int value = (strcmp(response, "true\n") == 0);
+static int readBoolean(void) {
+    double started = beginRead();
+    int value = Protocol_readBoolean();
+    endRead(started);
     return value;
 }
 
-int getAck(char* command) {
-    printf("%s\n", command);
-    fflush(stdout);
-    char response[BUFFER_SIZE];
-    fgets(response, BUFFER_SIZE, stdin);
-    int success = (strcmp(response, "ack\n") == 0);
+static int readAck(void) {
+    double started = beginRead();
+    int success = Protocol_readAck();
+    endRead(started);
     return success;
 }
 
+static void answerMotions(void);
+
+static int getInteger(const Command* command) {
+    sendQuery(command);
+    answerMotions();
+    return readInteger();
+}
+
+static int getBoolean(const Command* command) {
+    sendQuery(command);
+    answerMotions();
+    return readBoolean();
+}
+
+static int getAck(const Command* command) {
+    sendQuery(command);
+    answerMotions();
+    return readAck();
+}
+
 int API_mazeWidth() {
-    return getInteger("mazeWidth");
+    return getInteger(&MAZE_WIDTH);
 }
 
 int API_mazeHeight() {
-    return getInteger("mazeHeight");
+    return getInteger(&MAZE_HEIGHT);
 }
 
 int API_wallFront() {
-    return getBoolean("wallFront");
+    return getBoolean(&WALL_FRONT);
 }
 
 int API_wallRight() {
-    return getBoolean("wallRight");
+    return getBoolean(&WALL_RIGHT);
 }
 
 int API_wallLeft() {
-    return getBoolean("wallLeft");
+    return getBoolean(&WALL_LEFT);
 }
 
-int API_moveForward() {
-    int success = getAck("moveForward");
-    if (!success) {
-        logMessage("moveForward failed (no ack)");
-        return success;
+// The three queries go out in one write and the simulator answers them in
+// order, so the process blocks once instead of three times.
+static void sendWallQueries(void) {
+    sendCommand(&WALL_FRONT);
+    sendCommand(&WALL_LEFT);
+    sendCommand(&WALL_RIGHT);
+    sendCommand(&WAS_RESET);
+}
+
+static int readWalls(void) {
+    answerMotions();
+    int walls = 0;
+    if (readBoolean()) {
+        walls |= API_WALL_FRONT;
     }
-    if (!trackingInitialized) {
-        return success;
+    if (readBoolean()) {
+        walls |= API_WALL_LEFT;
     }
-    updatePosition();
-    publishPosition();
-    char logBuffer[64];
-    snprintf(logBuffer, sizeof(logBuffer), "Moved to (%d, %d)", mouseX, mouseY);
-    logMessage(logBuffer);
-    return success;
+    if (readBoolean()) {
+        walls |= API_WALL_RIGHT;
+    }
+    if (readBoolean()) {
+        walls |= API_WALL_RESET;
+    }
+    return walls;
 }
 
-void API_turnRight() {
-    int success = getAck("turnRight");
+int API_senseWalls() {
+    sendWallQueries();
+    API_flush();
+    return readWalls();
+}
+
+// Updates tracking for a motion the simulator has answered.
+static void completeMotion(const QueuedMotion* motion, int success) {
     if (!success) {
-        logMessage("turnRight failed (no ack)");
+        logMessage(motion->kind == MOTION_MOVE ? "move failed (no ack)" : "turn failed (no ack)");
+        if (motion->kind == MOTION_MOVE && motion->amount > 2) {
+            logMessage("Multi-cell move crashed; position unknown");
+            poseLost = 1;
+        }
         return;
     }
     if (!trackingInitialized) {
         return;
     }
-    mouseHeading = (API_Direction)((mouseHeading + 1) % 4);
+    if (motion->kind == MOTION_TURN) {
+        heading8 = (heading8 + motion->amount + 8) % 8;
+#ifndef HEADLESS
+        if (heading8 % 2 == 0) {
+            char logBuffer[64];
+            snprintf(logBuffer, sizeof(logBuffer), "Turned; heading %s", headingToString(API_mouseHeading()));
+            logMessage(logBuffer);
+        }
+#endif
+        return;
+    }
+    updatePosition(motion->amount);
+    publishPosition();
+#ifndef HEADLESS
     char logBuffer[64];
-    snprintf(logBuffer, sizeof(logBuffer), "Turned right; heading %s", headingToString(mouseHeading));
+    snprintf(logBuffer, sizeof(logBuffer), "Moved to (%d, %d)", API_mouseX(), API_mouseY());
     logMessage(logBuffer);
+#endif
 }
 
-void API_turnLeft() {
-    int success = getAck("turnLeft");
-    if (!success) {
-        logMessage("turnLeft failed (no ack)");
+// Reads the answers to every queued motion; they precede the answer to any
+// query sent after them.
+static void answerMotions(void) {
+    if (queuedCount == 0) {
         return;
     }
-    if (!trackingInitialized) {
+    API_flush();
+    for (int i = 0; i < queuedCount; ++i) {
+        int success = readAck();
+        completeMotion(&queuedMotions[i], success);
+        queuedCrashed |= !success;
+    }
+    queuedCount = 0;
+}
+
+static void addMotion(MotionKind kind, int amount) {
+    queuedMotions[queuedCount++] = (QueuedMotion){kind, amount};
+}
+
+static void queueMotion(MotionKind kind, int amount, const Command* command) {
+    if (queuedCount == MAX_QUEUED_MOTIONS) {
+        answerMotions();
+    }
+    sendCommand(command);
+    addMotion(kind, amount);
+}
+
+// A move of count units: the bare command for one, with the count otherwise.
+static void queueMove(const Command* command, int count, int halfSteps) {
+    if (count == 1) {
+        queueMotion(MOTION_MOVE, halfSteps, command);
         return;
     }
-    mouseHeading = (API_Direction)((mouseHeading + 3) % 4);
-    char logBuffer[64];
-    snprintf(logBuffer, sizeof(logBuffer), "Turned left; heading %s", headingToString(mouseHeading));
-    logMessage(logBuffer);
+    if (queuedCount == MAX_QUEUED_MOTIONS) {
+        answerMotions();
+    }
+    CommandLine line;
+    beginLine(&line, command);
+    putInteger(&line, count);
+    sendLine(&line, STATS_COMMAND_MOVE);
+    addMotion(MOTION_MOVE, halfSteps);
+}
+
+void API_queueMoveForward(int distance) {
+    if (distance > 0) {
+        queueMove(&MOVE_FORWARD, distance, 2 * distance);
+    }
+}
+
+void API_queueMoveForwardHalf(int halfSteps) {
+    if (halfSteps > 0) {
+        queueMove(&MOVE_FORWARD_HALF, halfSteps, halfSteps);
+    }
+}
+
+void API_queueTurnRight() {
+    queueMotion(MOTION_TURN, 2, &TURN_RIGHT);
+}
+
+void API_queueTurnLeft() {
+    queueMotion(MOTION_TURN, -2, &TURN_LEFT);
+}
+
+void API_queueTurnRight45() {
+    queueMotion(MOTION_TURN, 1, &TURN_RIGHT_45);
+}
+
+void API_queueTurnLeft45() {
+    queueMotion(MOTION_TURN, -1, &TURN_LEFT_45);
+}
+
+int API_receiveQueued() {
+    answerMotions();
+    int success = !queuedCrashed;
+    queuedCrashed = 0;
+    return success;
+}
+
+int API_moveForward() {
+    return API_moveForwardN(1);
+}
+
+// The simulator drives a multi-cell move until it reaches a wall, and a
+// crash does not say how far it got. Only ask for several cells over
+// passages already seen open; if one crashes anyway, API_poseLost reports
+// it. A crashed one-cell move hits the wall of the cell it started in.
+int API_moveForwardN(int distance) {
+    API_queueMoveForward(distance);
+    return API_receiveQueued();
+}
+
+// The move and the three wall queries go out in one write. A one-cell move
+// that crashes hits the wall on the far side of the cell it started in, so
+// the walls describe that cell.
+int API_moveForwardAndSense(int* walls) {
+    API_sendMoveForwardAndSense();
+    return API_receiveMoveForwardAndSense(walls);
+}
+
+void API_sendMoveForwardAndSense() {
+    API_queueMoveForward(1);
+    sendWallQueries();
+    API_flush();
+}
+
+int API_receiveMoveForwardAndSense(int* walls) {
+    int success = API_receiveQueued();
+    *walls = readWalls();
+    return success;
+}
+
+void API_turnRight() {
+    API_queueTurnRight();
+    API_receiveQueued();
+}
+
+void API_turnLeft() {
+    API_queueTurnLeft();
+    API_receiveQueued();
 }
 
 void API_initMouseTracking() {
-    mouseX = 0;
-    mouseY = 0;
-    mouseHeading = API_DIR_NORTH;
+    halfX = 1;
+    halfY = 1;
+    heading8 = 0;
+    poseLost = 0;
     trackingInitialized = 1;
     publishPosition();
     logMessage("Mouse tracking initialized at (0, 0)");
 }
 
 int API_mouseX() {
-    return mouseX;
+    return halfX / 2;
 }
 
 int API_mouseY() {
-    return mouseY;
+    return halfY / 2;
 }
 
 API_Direction API_mouseHeading() {
-    return mouseHeading;
+    return (API_Direction)(heading8 / 2);
+}
+
+int API_poseLost() {
+    return poseLost;
+}
+
+static const Command SET_WALL = COMMAND("setWall", STATS_COMMAND_DRAW);
+static const Command CLEAR_WALL = COMMAND("clearWall", STATS_COMMAND_DRAW);
+static const Command SET_COLOR = COMMAND("setColor", STATS_COMMAND_DRAW);
+static const Command CLEAR_COLOR = COMMAND("clearColor", STATS_COMMAND_DRAW);
+static const Command SET_TEXT = COMMAND("setText", STATS_COMMAND_DRAW);
+static const Command CLEAR_TEXT = COMMAND("clearText", STATS_COMMAND_DRAW);
+
+// Every display command starts with a cell.
+static void beginCellLine(CommandLine* line, const Command* command, int x, int y) {
+    beginLine(line, command);
+    putInteger(line, x);
+    putInteger(line, y);
 }
 
 void API_setWall(int x, int y, char direction) {
-    printf("setWall %d %d %c\n", x, y, direction);
-    fflush(stdout);
+    CommandLine line;
+    beginCellLine(&line, &SET_WALL, x, y);
+    putChar(&line, ' ');
+    putChar(&line, direction);
+    sendLine(&line, STATS_COMMAND_DRAW);
 }
 
 void API_clearWall(int x, int y, char direction) {
-    printf("clearWall %d %d %c\n", x, y, direction);
-    fflush(stdout);
+    CommandLine line;
+    beginCellLine(&line, &CLEAR_WALL, x, y);
+    putChar(&line, ' ');
+    putChar(&line, direction);
+    sendLine(&line, STATS_COMMAND_DRAW);
 }
 
 void API_setColor(int x, int y, char color) {
-    printf("setColor %d %d %c\n", x, y, color);
-    fflush(stdout);
+    CommandLine line;
+    beginCellLine(&line, &SET_COLOR, x, y);
+    putChar(&line, ' ');
+    putChar(&line, color);
+    sendLine(&line, STATS_COMMAND_DRAW);
 }
 
 void API_clearColor(int x, int y) {
-    printf("clearColor %d %d\n", x, y);
-    fflush(stdout);
+    CommandLine line;
+    beginCellLine(&line, &CLEAR_COLOR, x, y);
+    sendLine(&line, STATS_COMMAND_DRAW);
 }
 
 void API_clearAllColor() {
-    printf("clearAllColor\n");
-    fflush(stdout);
+    sendCommand(&CLEAR_ALL_COLOR);
 }
 
 void API_setText(int x, int y, char* text) {
-    printf("setText %d %d %s\n", x, y, text);
-    fflush(stdout);
+    CommandLine line;
+    beginCellLine(&line, &SET_TEXT, x, y);
+    putString(&line, text);
+    sendLine(&line, STATS_COMMAND_DRAW);
 }
 
 void API_clearText(int x, int y) {
-    printf("clearText %d %d\n", x, y);
-    fflush(stdout);
+    CommandLine line;
+    beginCellLine(&line, &CLEAR_TEXT, x, y);
+    sendLine(&line, STATS_COMMAND_DRAW);
 }
 
 void API_clearAllText() {
-    printf("clearAllText\n");
-    fflush(stdout);
+    sendCommand(&CLEAR_ALL_TEXT);
+}
+
+void API_flush() {
+    Protocol_flush();
 }
 
 int API_wasReset() {
-    return getBoolean("wasReset");
+    return getBoolean(&WAS_RESET);
 }
 
 void API_ackReset() {
-    getAck("ackReset");
+    getAck(&ACK_RESET);
+    if (trackingInitialized) {
+        API_initMouseTracking();
+    }
 }
@@ -14,14 +14,47 @@ int API_wallFront();
 int API_wallRight();
 int API_wallLeft();
 
+// Bits returned by API_senseWalls.
+#define API_WALL_FRONT 1
+#define API_WALL_LEFT 2
+#define API_WALL_RIGHT 4
+#define API_WALL_RESET 8  // the simulator was reset; the wall bits are from the start cell
+
+int API_senseWalls();  // Front, left and right walls and wasReset in a single round trip
+
 int API_moveForward();  // Returns 0 if crash, else returns 1
+int API_moveForwardN(int distance);  // Moves distance cells in one command; see API_poseLost
+int API_moveForwardAndSense(int* walls);  // Moves one cell, then senses as API_senseWalls
+// API_moveForwardAndSense in two halves, so the caller can work while the
+// simulator answers: the first sends the batch, the second reads it.
+void API_sendMoveForwardAndSense();
+int API_receiveMoveForwardAndSense(int* walls);
 void API_turnRight();
 void API_turnLeft();
 
+// Motion commands can be queued so that a turn and the moves after it reach
+// the simulator in one write. Queued motions are answered, and the tracked
+// position updated, by API_receiveQueued or before any query sent after
+// them. API_receiveQueued returns 0 if one of them crashed. The motions
+// after a crash still run, from wherever it left the mouse, and tracking
+// follows them.
+void API_queueMoveForward(int distance);
+void API_queueMoveForwardHalf(int halfSteps);  // newer mms versions only
+void API_queueTurnRight();
+void API_queueTurnLeft();
+void API_queueTurnRight45();  // newer mms versions only
+void API_queueTurnLeft45();   // newer mms versions only
+int API_receiveQueued();
+
 void API_initMouseTracking();
 int API_mouseX();
 int API_mouseY();
 API_Direction API_mouseHeading();
+// True once a move of several cells has crashed: the mouse stopped at the
+// first wall, somewhere along the way, and the tracked position is no longer
+// where it is. A crashed one-cell move does not count; it never leaves the
+// cell. Cleared by API_initMouseTracking.
+int API_poseLost();
 
 void API_setWall(int x, int y, char direction);
 void API_clearWall(int x, int y, char direction);
@@ -34,5 +67,9 @@ void API_setText(int x, int y, char* str);
 void API_clearText(int x, int y);
 void API_clearAllText();
 
+// Output-only commands are buffered until the next query or process exit;
+// this sends them immediately.
+void API_flush();
+
 int API_wasReset();
-void API_ackReset();
+void API_ackReset();  // Also puts the tracked position back at the start
@@ -0,0 +1,249 @@
+#include "Explore.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+typedef enum {
+    PHASE_SEARCH = 0,  // heading for the centre, or for cells worth exploring
+    PHASE_TO_START,
+    PHASE_DONE
+} ExplorePhase;
+
+typedef struct {
+    const char* name;
+    int (*update)(FloodfillCell current);
+} ExploreStrategyEntry;
+
+static ExploreStrategy activeStrategy = EXPLORE_CENTER_AND_BACK;
+static ExplorePhase phase = PHASE_SEARCH;
+static FloodfillCell startCell = {0, 0};
+static FloodfillCell centerGoals[FLOODFILL_MAX_GOALS];
+static int centerGoalCount = 0;
+static FloodfillCell target = {-1, -1};
+// Distance fields for the shortest-path strategy: optimistic distance to the
+// centre and from the start, and pessimistic distance to the centre, cached
+// by Floodfill, plus the optimistic distance from the mouse, which changes
+// every step and is flooded into storage sized by Explore_init.
+static FloodfillField centerField = -1;
+static FloodfillField provenCenterField = -1;
+static FloodfillField startField = -1;
+static const int* toCenter = NULL;
+static const int* provenToCenter = NULL;
+static const int* fromStart = NULL;
+static int* fromMouse = NULL;
+static int mazeWidth = 0;
+static int cellCount = 0;
+
+static void logMessage(const char* text) {
+#ifndef HEADLESS
+    fprintf(stderr, "%s\n", text);
+    fflush(stderr);
+#else
+    (void)text;
+#endif
+}
+
+static int cellsEqual(FloodfillCell a, FloodfillCell b) {
+    return a.x == b.x && a.y == b.y;
+}
+
+static int cellIndex(FloodfillCell cell) {
+    return cell.y * mazeWidth + cell.x;
+}
+
+static int isCenterCell(FloodfillCell cell) {
+    for (int i = 0; i < centerGoalCount; ++i) {
+        if (cellsEqual(cell, centerGoals[i])) {
+            return 1;
+        }
+    }
+    return 0;
+}
+
+static void setTarget(FloodfillCell cell) {
+    if (cellsEqual(cell, target)) {
+        return;
+    }
+    target = cell;
+    Floodfill_setGoals(&target, 1);
+}
+
+// Exploration targets change nearly every step, so they are not drawn.
+static void setExplorationTarget(FloodfillCell cell) {
+    if (cellsEqual(cell, target)) {
+        return;
+    }
+    target = cell;
+    Floodfill_setTemporaryGoals(&target, 1);
+}
+
+static void headToStart(void) {
+    phase = PHASE_TO_START;
+    setTarget(startCell);
+}
+
+// Shared by every strategy once its search is over.
+static int updateReturn(FloodfillCell current) {
+    if (phase == PHASE_TO_START && cellsEqual(current, startCell)) {
+        logMessage("Returned to start; run complete");
+        phase = PHASE_DONE;
+    }
+    return phase != PHASE_DONE;
+}
+
+static int updateCenterAndBack(FloodfillCell current) {
+    if (phase == PHASE_SEARCH && isCenterCell(current)) {
+        logMessage("Reached center; targeting start");
+        headToStart();
+    }
+    return updateReturn(current);
+}
+
+// Cell with an unknown edge on some optimistic shortest start-to-centre path
+// that the mouse can reach soonest, or {-1, -1} when there is none.
+static FloodfillCell nearestOpenQuestion(int bound) {
+    FloodfillCell best = {-1, -1};
+    int bestDistance = -1;
+    int bestToCenter = -1;
+    for (int index = 0; index < cellCount; ++index) {
+        if (fromStart[index] < 0 || toCenter[index] < 0 || fromMouse[index] < 0 ||
+            fromStart[index] + toCenter[index] != bound) {
+            continue;
+        }
+        FloodfillCell cell = {index % mazeWidth, index / mazeWidth};
+        if (Floodfill_isVisited(cell)) {
+            continue;
+        }
+        if (bestDistance < 0 || fromMouse[index] < bestDistance ||
+            (fromMouse[index] == bestDistance && toCenter[index] < bestToCenter)) {
+            best = cell;
+            bestDistance = fromMouse[index];
+            bestToCenter = toCenter[index];
+        }
+    }
+    return best;
+}
+
+// The optimistic flood is a lower bound on the start-to-centre distance and
+// the pessimistic flood is an achievable one; once they agree the shortest
+// path is proven and nothing else needs exploring. Until then the mouse
+// visits cells on optimistic shortest paths whose walls are not all known,
+// since only those can change either bound.
+static int floodBounds(void) {
+    toCenter = Floodfill_fieldDistances(centerField);
+    provenToCenter = Floodfill_fieldDistances(provenCenterField);
+    if (toCenter == NULL || provenToCenter == NULL) {
+        return -1;
+    }
+    return toCenter[cellIndex(startCell)];
+}
+
+static int updateShortestPath(FloodfillCell current) {
+    if (phase != PHASE_SEARCH) {
+        return updateReturn(current);
+    }
+    int bound = floodBounds();
+    if (bound < 0) {
+        logMessage("Center unreachable; targeting start");
+        headToStart();
+        return updateReturn(current);
+    }
+    if (provenToCenter[cellIndex(startCell)] == bound) {
+        logMessage("Shortest path proven; targeting start");
+        headToStart();
+        return updateReturn(current);
+    }
+    fromStart = Floodfill_fieldDistances(startField);
+    if (fromStart == NULL) {
+        logMessage("Start distances unavailable; targeting start");
+        headToStart();
+        return updateReturn(current);
+    }
+    Floodfill_floodDistances(&current, 1, FLOODFILL_UNKNOWN_OPEN, fromMouse);
+    FloodfillCell next = nearestOpenQuestion(bound);
+    if (next.x < 0) {
+        logMessage("No cells left to explore; targeting start");
+        headToStart();
+        return updateReturn(current);
+    }
+    setExplorationTarget(next);
+    return 1;
+}
+
+static const ExploreStrategyEntry STRATEGIES[EXPLORE_STRATEGY_COUNT] = {
+    {"center-and-back", updateCenterAndBack},
+    {"shortest-path", updateShortestPath},
+};
+
+static void releaseStorage(void) {
+    free(fromMouse);
+    fromMouse = NULL;
+}
+
+int Explore_init(void) {
+    releaseStorage();
+    mazeWidth = Floodfill_mazeWidth();
+    cellCount = Floodfill_cellCount();
+    if (cellCount <= 0) {
+        logMessage("Explore_init called before Floodfill_init");
+        return 0;
+    }
+    fromMouse = malloc((size_t)cellCount * sizeof(*fromMouse));
+    if (fromMouse == NULL) {
+        logMessage("Explore storage allocation failed");
+        releaseStorage();
+        return 0;
+    }
+    return 1;
+}
+
+ExploreStrategy Explore_strategyNamed(const char* name, ExploreStrategy fallback) {
+    if (name == NULL) {
+        return fallback;
+    }
+    for (int i = 0; i < EXPLORE_STRATEGY_COUNT; ++i) {
+        if (strcmp(name, STRATEGIES[i].name) == 0) {
+            return (ExploreStrategy)i;
+        }
+    }
+    logMessage("Unknown exploration strategy; using default");
+    return fallback;
+}
+
+const char* Explore_strategyName(ExploreStrategy strategy) {
+    if (strategy < 0 || strategy >= EXPLORE_STRATEGY_COUNT) {
+        return "unknown";
+    }
+    return STRATEGIES[strategy].name;
+}
+
+void Explore_begin(ExploreStrategy strategy,
+                   FloodfillCell start,
+                   const FloodfillCell* goals,
+                   int goalCount) {
+    activeStrategy = (strategy >= 0 && strategy < EXPLORE_STRATEGY_COUNT) ? strategy : EXPLORE_CENTER_AND_BACK;
+    phase = PHASE_SEARCH;
+    startCell = start;
+    centerGoalCount = 0;
+    for (int i = 0; i < goalCount && centerGoalCount < FLOODFILL_MAX_GOALS; ++i) {
+        centerGoals[centerGoalCount++] = goals[i];
+    }
+    target = (FloodfillCell){-1, -1};
+    centerField = Floodfill_defineField("center", centerGoals, centerGoalCount, FLOODFILL_UNKNOWN_OPEN);
+    provenCenterField = Floodfill_defineField("center-proven", centerGoals, centerGoalCount, FLOODFILL_UNKNOWN_WALL);
+    startField = Floodfill_defineField("start", &startCell, 1, FLOODFILL_UNKNOWN_OPEN);
+    Floodfill_setGoals(centerGoals, centerGoalCount);
+}
+
+int Explore_isShortestPathProven(void) {
+    if (centerGoalCount == 0) {
+        return 0;
+    }
+    int bound = floodBounds();
+    return bound >= 0 && provenToCenter[cellIndex(startCell)] == bound;
+}
+
+int Explore_update(FloodfillCell current) {
+    return STRATEGIES[activeStrategy].update(current);
+}
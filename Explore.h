@@ -0,0 +1,35 @@
+#pragma once
+
+#include "Floodfill.h"
+
+// Search-run strategies. Each one steers the mouse by setting Floodfill's
+// goals; the main loop descends the resulting distances.
+typedef enum {
+    EXPLORE_CENTER_AND_BACK = 0,  // flood to the centre, then back to the start
+    EXPLORE_SHORTEST_PATH,        // visit only cells that could still shorten the best path
+    EXPLORE_STRATEGY_COUNT
+} ExploreStrategy;
+
+// Strategy used when none is requested; override at build time with -D.
+#ifndef EXPLORE_DEFAULT_STRATEGY
+#define EXPLORE_DEFAULT_STRATEGY EXPLORE_SHORTEST_PATH
+#endif
+
+// Sizes the search storage for the maze Floodfill was initialised with.
+// Call after Floodfill_init; returns 0 if allocation failed.
+int Explore_init(void);
+// Looks a strategy up by name ("center-and-back", "shortest-path"); returns
+// fallback for NULL or unknown names.
+ExploreStrategy Explore_strategyNamed(const char* name, ExploreStrategy fallback);
+const char* Explore_strategyName(ExploreStrategy strategy);
+void Explore_begin(ExploreStrategy strategy,
+                   FloodfillCell start,
+                   const FloodfillCell* goals,
+                   int goalCount);
+// Points Floodfill at wherever the mouse should head next from current.
+// Call after the current cell's walls are recorded; returns 0 once the
+// search run is over and the mouse is back at the start.
+int Explore_update(FloodfillCell current);
+// True when the known walls already pin down the shortest start-to-centre
+// path, whichever strategy is active.
+int Explore_isShortestPathProven(void);
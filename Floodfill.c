@@ -1,157 +1,293 @@
 #include "Floodfill.h"
+#include "Stats.h"
 
+#include <limits.h>
 #include <stdbool.h>
+#include <stdint.h>
 #include <stdio.h>
+#include <stdlib.h>
 #include <string.h>
+#ifdef BENCHMARK
+#include <time.h>
+#endif
 
+// Cells popped by a single incremental repair, per maze cell, before it is
+// abandoned in favour of a full flood.
+#define FLOODFILL_REPAIR_BUDGET_PER_CELL 4
+
+// Cells a single outcome prediction may pop before that outcome is left to
+// the ordinary recalculation. Most sensed cells move only a few distances,
+// and a prediction is work done whether or not its outcome comes true.
+#ifndef FLOODFILL_PREDICT_BUDGET
+#define FLOODFILL_PREDICT_BUDGET 32
+#endif
+
+// Front, left and right wall outcomes of sensing one cell.
+#define OUTCOME_COUNT 8
+#define NO_PREDICTION -1
+
+// Shadow value for a cell whose simulator text is not known to us.
+#define DISPLAY_UNKNOWN -2
+
+// Saved map: magic, version, width, height, then the north, east, known
+// north and known east rows, one little-endian 64-bit word per maze row.
+#define MAP_MAGIC "MMSM"
+#define MAP_VERSION 1
+#define MAP_HEADER_SIZE 8
+#define MAP_ROW_ARRAYS 4
+
+// Each maze row is one 64-bit word of wall bits.
+#if FLOODFILL_MAX_WIDTH > 64
+#error "FLOODFILL_MAX_WIDTH must fit in a 64-bit row"
+#endif
+
+typedef uint64_t WallRow;
+
+// Where one edge lives in wallWords/knownWords/sensedWords.
+typedef struct {
+    uint16_t word;
+    uint8_t bit;
+} EdgeSlot;
+
+// Working rows for one flood at a time.
+typedef struct {
+    WallRow* visited;
+    WallRow* frontier;
+    WallRow* next;
+} FloodScratch;
+
+// A copy of the walls, pruned cells and active goals taken by
+// Floodfill_takeSnapshot. walls has the wallWords layout; work is walls with
+// one sensor outcome applied.
+struct FloodfillSnapshot {
+    FloodfillCell goals[FLOODFILL_MAX_GOALS];
+    int goalCount;
+    FloodfillCell cell;  // where the outcomes are sensed
+    API_Direction heading;
+    int wordCount;
+    WallRow* walls;
+    WallRow* work;
+    WallRow* excluded;
+    FloodScratch scratch;
+};
+
+// How repair reads and writes distances: the active field directly, or a
+// copy-on-write overlay of it while predicting.
 typedef struct {
-    FloodfillCell elements[FLOODFILL_MAX_WIDTH * FLOODFILL_MAX_HEIGHT];
-    int head;
-    int tail;
-    int count;
-} FloodfillQueue;
+    int (*get)(int index);
+    void (*set)(int index, int value);
+} DistanceAccess;
+
+// One cached flood. Unnamed fields hold recent Floodfill_setGoals goal sets
+// and are recycled least recently used first; named ones stay until the
+// maze is reinitialised.
+typedef struct {
+    char name[FLOODFILL_FIELD_NAME_SIZE];
+    FloodfillCell goals[FLOODFILL_MAX_GOALS];
+    int goalCount;
+    FloodfillAssumption assumption;
+    int inUse;
+    long version;   // map version the distances were flooded at, or -1
+    long lastUsed;
+    int* distances;
+} DistanceField;
 
 static int mazeWidth = 0;
 static int mazeHeight = 0;
 static int moduleInitialized = 0;
-static int distances[FLOODFILL_MAX_HEIGHT][FLOODFILL_MAX_WIDTH];
-static unsigned char horizontalWalls[FLOODFILL_MAX_HEIGHT + 1][FLOODFILL_MAX_WIDTH];
-static unsigned char verticalWalls[FLOODFILL_MAX_HEIGHT][FLOODFILL_MAX_WIDTH + 1];
+static int cellCount = 0;
+static WallRow rowMask = 0;
+// Per-maze storage, allocated once by Floodfill_init. Cell arrays are indexed
+// by y * mazeWidth + x. Wall rows are indexed by y with bit x set when cell
+// (x, y) has a wall on its north (northWalls) or east (eastWalls) side; the
+// south edge of row 0 and the west edge of column 0 are implicit.
+// knownNorth/knownEast share that layout and mark edges that have been sensed
+// or driven through, so a clear wall bit alone only means "not seen yet".
+// sensedWords is laid out like knownWords but leaves out edges that have only
+// come from a saved map. visitedRows marks cells with all four edges known,
+// and closedNorth/closedEast hold the pessimistic walls built from the known
+// bits.
+// Both wall layouts live in one word array each: the north rows, then the
+// east rows, then a single all-ones word that stands for the south and west
+// outline, so every edge of every cell has a real bit to look up.
+// distances is the active field's array, the one Floodfill_setGoals chose
+// and incremental repair keeps current.
+static int* distances = NULL;
+static int* fieldStorage = NULL;
+static DistanceField fields[FLOODFILL_MAX_FIELDS];
+static int activeField = -1;
+static long fieldClock = 0;
+// Bumped whenever a wall bit changes, and (mapVersion) whenever any wall or
+// known bit does; optimistic fields depend only on the first.
+static long wallVersion = 0;
+static long mapVersion = 0;
+static WallRow* wallWords = NULL;
+static WallRow* knownWords = NULL;
+static WallRow* sensedWords = NULL;
+static WallRow* northWalls = NULL;
+static WallRow* eastWalls = NULL;
+static WallRow* knownNorth = NULL;
+static WallRow* knownEast = NULL;
+// Geometry tables built once by Floodfill_init and indexed by
+// cell * 4 + direction: the neighbouring cell index (-1 off the maze) and
+// the slot of the edge between them.
+static int* neighborIndex = NULL;
+static EdgeSlot* edgeSlots = NULL;
+static WallRow* visitedRows = NULL;
+static WallRow* closedNorth = NULL;
+static WallRow* closedEast = NULL;
+static WallRow* floodVisited = NULL;
+static WallRow* floodFrontier = NULL;
+static WallRow* floodNext = NULL;
 static FloodfillCell goalCells[FLOODFILL_MAX_GOALS];
 static int goalCellCount = 0;
+static int distancesValid = 0;
+static int* repairStack = NULL;
+static int repairStackSize = 0;
+static unsigned char* repairQueued = NULL;
+static int* shownDistances = NULL;
+// Pruning. excludedRows marks cells no path between two anchors (the start,
+// the centre goals, the mouse and the current goals) can use: dead-end
+// chains and regions cut off from the mouse. openDegree counts each cell's
+// open edges to cells that are not excluded; pruneStack holds cells whose
+// count dropped and may now be dead ends.
+static WallRow* excludedRows = NULL;
+static unsigned char* openDegree = NULL;
+static int* pruneStack = NULL;
+static int pruneStackSize = 0;
+static unsigned char* pruneQueued = NULL;
+static int pruningEnabled = 0;
+static int pruneStartIndex = -1;
+static int pruneGoalIndices[FLOODFILL_MAX_GOALS];
+static int pruneGoalCount = 0;
+static int mouseIndex = -1;
+static long pruneScanVersion = -1;
+// Prediction state. specDistances/specStamp are a copy-on-write overlay of
+// the active distances: an entry is live only while its stamp matches
+// specGeneration, so starting a fresh overlay costs one increment.
+// specTouched lists the live entries. Each predicted outcome keeps its
+// overlay as a delta (predictIndex/predictValue from predictStart, of
+// predictLength entries) plus the direction it leads to.
+static int* specDistances = NULL;
+static unsigned* specStamp = NULL;
+static unsigned specGeneration = 0;
+static int* specTouched = NULL;
+static int specTouchedCount = 0;
+static int* predictIndex = NULL;
+static int* predictValue = NULL;
+static int predictStart[OUTCOME_COUNT];
+static int predictLength[OUTCOME_COUNT];
+static int predictToggles[OUTCOME_COUNT];
+static int predictDirection[OUTCOME_COUNT];
+static int predictionReady = 0;
+static int predictCell = -1;
+static API_Direction predictHeading = API_DIR_NORTH;
+static long predictVersion = -1;
+static int predictField = -1;
+// The committed outcome's direction, valid while the walls and goals stay
+// as they were committed.
+static int committedDirection = NO_PREDICTION;
+static long committedVersion = -1;
+static int displayStale = 0;
+// Set while the goals are temporary: their distances are left off the
+// display, which would otherwise be redrawn whole for every new target.
+static int displayHidden = 0;
+static int temporaryField = -1;
+static FloodfillProfile profile;
 
 static void logMessage(const char* text) {
+#ifndef HEADLESS
     fprintf(stderr, "%s\n", text);
     fflush(stderr);
+#else
+    (void)text;
+#endif
 }
 
-static void queueInit(FloodfillQueue* queue) {
-    queue->head = 0;
-    queue->tail = 0;
-    queue->count = 0;
+static int cellIndex(FloodfillCell cell) {
+    return cell.y * mazeWidth + cell.x;
 }
 
-static int queueIsEmpty(const FloodfillQueue* queue) {
-    return queue->count == 0;
+static int isValidCell(FloodfillCell cell) {
+    return cell.x >= 0 && cell.x < mazeWidth && cell.y >= 0 && cell.y < mazeHeight;
 }
 
-static void queuePush(FloodfillQueue* queue, FloodfillCell cell) {
-    if (queue->count >= FLOODFILL_MAX_WIDTH * FLOODFILL_MAX_HEIGHT) {
-        logMessage("Floodfill queue overflow");
-        return;
-    }
-    queue->elements[queue->tail] = cell;
-    queue->tail = (queue->tail + 1) % (FLOODFILL_MAX_WIDTH * FLOODFILL_MAX_HEIGHT);
-    queue->count += 1;
+static FloodfillCell indexCell(int index) {
+    return (FloodfillCell){index % mazeWidth, index / mazeWidth};
 }
 
-static FloodfillCell queuePop(FloodfillQueue* queue) {
-    FloodfillCell cell = {0, 0};
-    if (queueIsEmpty(queue)) {
-        return cell;
-    }
-    cell = queue->elements[queue->head];
-    queue->head = (queue->head + 1) % (FLOODFILL_MAX_WIDTH * FLOODFILL_MAX_HEIGHT);
-    queue->count -= 1;
-    return cell;
+static WallRow cellBit(int x) {
+    return (WallRow)1 << x;
 }
 
-static int isValidCell(FloodfillCell cell) {
-    return cell.x >= 0 && cell.x < mazeWidth && cell.y >= 0 && cell.y < mazeHeight;
+static int edgeKey(int index, API_Direction direction) {
+    return index * 4 + (int)direction;
 }
 
-static FloodfillCell neighborCell(FloodfillCell cell, API_Direction direction) {
-    FloodfillCell neighbor = cell;
-    switch (direction) {
-        case API_DIR_NORTH:
-            neighbor.y += 1;
-            break;
-        case API_DIR_EAST:
-            neighbor.x += 1;
-            break;
-        case API_DIR_SOUTH:
-            neighbor.y -= 1;
-            break;
-        case API_DIR_WEST:
-            neighbor.x -= 1;
-            break;
-    }
-    return neighbor;
+static int hasWallAt(int index, API_Direction direction) {
+    EdgeSlot slot = edgeSlots[edgeKey(index, direction)];
+    return (int)(wallWords[slot.word] >> slot.bit) & 1;
 }
 
-static int isBoundaryEdge(FloodfillCell cell, API_Direction direction) {
-    switch (direction) {
-        case API_DIR_NORTH:
-            return cell.y >= mazeHeight - 1;
-        case API_DIR_EAST:
-            return cell.x >= mazeWidth - 1;
-        case API_DIR_SOUTH:
-            return cell.y <= 0;
-        case API_DIR_WEST:
-            return cell.x <= 0;
-    }
-    return 1;
+static int isEdgeKnownAt(int index, API_Direction direction) {
+    EdgeSlot slot = edgeSlots[edgeKey(index, direction)];
+    return (int)(knownWords[slot.word] >> slot.bit) & 1;
 }
 
-static unsigned char* wallSlot(FloodfillCell cell, API_Direction direction) {
-    switch (direction) {
-        case API_DIR_NORTH:
-            if (cell.y + 1 <= mazeHeight) {
-                return &horizontalWalls[cell.y + 1][cell.x];
-            }
-            break;
-        case API_DIR_EAST:
-            if (cell.x + 1 <= mazeWidth) {
-                return &verticalWalls[cell.y][cell.x + 1];
-            }
-            break;
-        case API_DIR_SOUTH:
-            if (cell.y >= 0) {
-                return &horizontalWalls[cell.y][cell.x];
-            }
-            break;
-        case API_DIR_WEST:
-            if (cell.x >= 0) {
-                return &verticalWalls[cell.y][cell.x];
-            }
-            break;
+// Records a sensed edge; returns 0 if it was already known, e.g. from a
+// saved map.
+static int markEdgeKnown(int index, API_Direction direction) {
+    EdgeSlot slot = edgeSlots[edgeKey(index, direction)];
+    WallRow bit = cellBit(slot.bit);
+    sensedWords[slot.word] |= bit;
+    if ((knownWords[slot.word] & bit) != 0) {
+        return 0;
     }
-    return NULL;
+    knownWords[slot.word] |= bit;
+    mapVersion += 1;
+    return 1;
 }
 
-static int hasWallBetween(FloodfillCell cell, API_Direction direction) {
-    unsigned char* slot = wallSlot(cell, direction);
-    if (slot == NULL) {
-        return 1;
+// Fills neighborIndex and edgeSlots for the current maze size. Off-maze
+// neighbours are -1; the south and west outline maps to the all-ones word.
+static void buildGeometry(void) {
+    uint16_t outline = (uint16_t)(2 * mazeHeight);
+    for (int y = 0; y < mazeHeight; ++y) {
+        for (int x = 0; x < mazeWidth; ++x) {
+            int index = y * mazeWidth + x;
+            int* neighbors = neighborIndex + edgeKey(index, API_DIR_NORTH);
+            EdgeSlot* slots = edgeSlots + edgeKey(index, API_DIR_NORTH);
+            neighbors[API_DIR_NORTH] = (y + 1 < mazeHeight) ? index + mazeWidth : -1;
+            neighbors[API_DIR_EAST] = (x + 1 < mazeWidth) ? index + 1 : -1;
+            neighbors[API_DIR_SOUTH] = (y > 0) ? index - mazeWidth : -1;
+            neighbors[API_DIR_WEST] = (x > 0) ? index - 1 : -1;
+            slots[API_DIR_NORTH] = (EdgeSlot){(uint16_t)y, (uint8_t)x};
+            slots[API_DIR_EAST] = (EdgeSlot){(uint16_t)(mazeHeight + y), (uint8_t)x};
+            slots[API_DIR_SOUTH] = (y > 0) ? (EdgeSlot){(uint16_t)(y - 1), (uint8_t)x} : (EdgeSlot){outline, 0};
+            slots[API_DIR_WEST] =
+                (x > 0) ? (EdgeSlot){(uint16_t)(mazeHeight + y), (uint8_t)(x - 1)} : (EdgeSlot){outline, 0};
+        }
     }
-    return *slot != 0;
 }
 
-static void updateNeighborWall(FloodfillCell cell, API_Direction direction, unsigned char value) {
-    FloodfillCell neighbor = neighborCell(cell, direction);
-    if (!isValidCell(neighbor)) {
+// Promotes a cell to visited once the last of its edges becomes known.
+static void refreshVisited(int index) {
+    if (index < 0) {
         return;
     }
-    unsigned char* neighborSlot = NULL;
-    switch (direction) {
-        case API_DIR_NORTH:
-            neighborSlot = wallSlot(neighbor, API_DIR_SOUTH);
-            break;
-        case API_DIR_EAST:
-            neighborSlot = wallSlot(neighbor, API_DIR_WEST);
-            break;
-        case API_DIR_SOUTH:
-            neighborSlot = wallSlot(neighbor, API_DIR_NORTH);
-            break;
-        case API_DIR_WEST:
-            neighborSlot = wallSlot(neighbor, API_DIR_EAST);
-            break;
+    FloodfillCell cell = indexCell(index);
+    if ((visitedRows[cell.y] & cellBit(cell.x)) != 0) {
+        return;
     }
-    if (neighborSlot != NULL) {
-        *neighborSlot = value;
+    for (API_Direction dir = API_DIR_NORTH; dir <= API_DIR_WEST; dir = (API_Direction)(dir + 1)) {
+        if (!isEdgeKnownAt(index, dir)) {
+            return;
+        }
     }
+    visitedRows[cell.y] |= cellBit(cell.x);
 }
 
+#ifndef HEADLESS
 static char directionToChar(API_Direction direction) {
     switch (direction) {
         case API_DIR_NORTH:
@@ -165,55 +301,437 @@ static char directionToChar(API_Direction direction) {
     }
     return '?';
 }
+#endif
 
+#ifndef HEADLESS
 static void displayDistance(FloodfillCell cell, int value) {
-    if (!isValidCell(cell)) {
+    if (!isValidCell(cell) || shownDistances[cellIndex(cell)] == value) {
         return;
     }
+    shownDistances[cellIndex(cell)] = value;
     if (value < 0) {
         API_clearText(cell.x, cell.y);
         return;
     }
-    char buffer[8];
+    char buffer[12];
     snprintf(buffer, sizeof(buffer), "%d", value);
     API_setText(cell.x, cell.y, buffer);
 }
 
+// Sends the simulator only the cells whose text differs from the shadow
+// buffer.
+static void publishDistances(void) {
+    displayStale = 0;
+    for (int y = 0; y < mazeHeight; ++y) {
+        for (int x = 0; x < mazeWidth; ++x) {
+            displayDistance((FloodfillCell){x, y}, displayHidden ? -1 : distances[y * mazeWidth + x]);
+        }
+    }
+}
+#else
+static void publishDistances(void) {
+    displayStale = 0;
+}
+#endif
+
 static void clearAllDistances(void) {
     for (int y = 0; y < mazeHeight; ++y) {
         for (int x = 0; x < mazeWidth; ++x) {
-            distances[y][x] = -1;
-            API_clearText(x, y);
+            distances[y * mazeWidth + x] = -1;
+        }
+    }
+}
+
+static int isExcludedIndex(int index) {
+    return (int)(excludedRows[index / mazeWidth] >> (index % mazeWidth)) & 1;
+}
+
+static int isGoalIndex(int index) {
+    for (int i = 0; i < goalCellCount; ++i) {
+        if (cellIndex(goalCells[i]) == index) {
+            return 1;
+        }
+    }
+    return 0;
+}
+
+static void queueRepair(int index) {
+    if (index < 0 || repairQueued[index]) {
+        return;
+    }
+    repairQueued[index] = 1;
+    repairStack[repairStackSize++] = index;
+}
+
+static void clearRepairStack(void) {
+    while (repairStackSize > 0) {
+        repairQueued[repairStack[--repairStackSize]] = 0;
+    }
+}
+
+static int activeDistance(int index) {
+    return distances[index];
+}
+
+static void setActiveDistance(int index, int value) {
+    distances[index] = value;
+}
+
+static const DistanceAccess ACTIVE_DISTANCES = {activeDistance, setActiveDistance};
+
+// Distance a cell should hold given its open neighbours, or -1 when none of
+// them can reach a goal. Every edge off the maze is a wall, so an open edge
+// always has a neighbour.
+static int consistentDistance(int index, const DistanceAccess* access) {
+    if (isGoalIndex(index)) {
+        return 0;
+    }
+    if (isExcludedIndex(index)) {
+        return -1;
+    }
+    const int* neighbors = neighborIndex + edgeKey(index, API_DIR_NORTH);
+    int best = -1;
+    for (API_Direction dir = API_DIR_NORTH; dir <= API_DIR_WEST; dir = (API_Direction)(dir + 1)) {
+        if (hasWallAt(index, dir)) {
+            continue;
+        }
+        int neighborDistance = access->get(neighbors[dir]);
+        if (neighborDistance >= 0 && (best < 0 || neighborDistance < best)) {
+            best = neighborDistance;
+        }
+    }
+    if (best < 0 || best + 1 >= cellCount) {
+        return -1;
+    }
+    return best + 1;
+}
+
+// Modified floodfill: pops cells whose neighbourhood changed and fixes their
+// distance, queueing the neighbours of every cell that moved. Returns 0 if
+// the budget ran out and the caller must fall back to a full flood.
+static int repairWith(int budget, const DistanceAccess* access, long* relaxed) {
+    while (repairStackSize > 0) {
+        if (budget-- <= 0) {
+            clearRepairStack();
+            return 0;
+        }
+        int index = repairStack[--repairStackSize];
+        repairQueued[index] = 0;
+        int value = consistentDistance(index, access);
+        if (value == access->get(index)) {
+            continue;
+        }
+        access->set(index, value);
+        *relaxed += 1;
+        const int* neighbors = neighborIndex + edgeKey(index, API_DIR_NORTH);
+        for (API_Direction dir = API_DIR_NORTH; dir <= API_DIR_WEST; dir = (API_Direction)(dir + 1)) {
+            if (!hasWallAt(index, dir)) {
+                queueRepair(neighbors[dir]);
+            }
+        }
+    }
+    return 1;
+}
+
+static int repairDistances(void) {
+    long relaxed = 0;
+    int repaired = repairWith(FLOODFILL_REPAIR_BUDGET_PER_CELL * cellCount, &ACTIVE_DISTANCES, &relaxed);
+    Stats_addCellsRelaxed(relaxed);
+    return repaired;
+}
+
+static int isAnchorIndex(int index) {
+    if (index == mouseIndex || index == pruneStartIndex || isGoalIndex(index)) {
+        return 1;
+    }
+    for (int i = 0; i < pruneGoalCount; ++i) {
+        if (pruneGoalIndices[i] == index) {
+            return 1;
+        }
+    }
+    return 0;
+}
+
+static void queuePrune(int index) {
+    if (index < 0 || pruneQueued[index]) {
+        return;
+    }
+    pruneQueued[index] = 1;
+    pruneStack[pruneStackSize++] = index;
+}
+
+// Takes a cell out of every flood. Nothing else's distance ran through it,
+// so the other cells keep theirs.
+static void excludeCell(int index) {
+    excludedRows[index / mazeWidth] |= cellBit(index % mazeWidth);
+    for (int i = 0; i < FLOODFILL_MAX_FIELDS; ++i) {
+        if (fields[i].inUse) {
+            fields[i].distances[index] = -1;
+        }
+    }
+    const int* neighbors = neighborIndex + edgeKey(index, API_DIR_NORTH);
+    for (API_Direction dir = API_DIR_NORTH; dir <= API_DIR_WEST; dir = (API_Direction)(dir + 1)) {
+        if (!hasWallAt(index, dir) && !isExcludedIndex(neighbors[dir])) {
+            openDegree[neighbors[dir]] -= 1;
+            queuePrune(neighbors[dir]);
+        }
+    }
+}
+
+// Dead-end filling: a cell with at most one way in or out can only be the
+// end of a path, so unless it is an anchor no useful path enters it.
+// Unknown edges count as open, so only known walls close a dead end.
+static void drainPrune(void) {
+    while (pruneStackSize > 0) {
+        int index = pruneStack[--pruneStackSize];
+        pruneQueued[index] = 0;
+        if (pruningEnabled && openDegree[index] <= 1 && !isExcludedIndex(index) && !isAnchorIndex(index)) {
+            excludeCell(index);
+        }
+    }
+}
+
+// Recounts every cell's open edges and prunes from scratch.
+static void rebuildPruning(void) {
+    memset(excludedRows, 0, mazeHeight * sizeof(*excludedRows));
+    memset(pruneQueued, 0, cellCount * sizeof(*pruneQueued));
+    pruneStackSize = 0;
+    pruneScanVersion = -1;
+    for (int index = 0; index < cellCount; ++index) {
+        int degree = 0;
+        for (API_Direction dir = API_DIR_NORTH; dir <= API_DIR_WEST; dir = (API_Direction)(dir + 1)) {
+            degree += !hasWallAt(index, dir);
+        }
+        openDegree[index] = (unsigned char)degree;
+        queuePrune(index);
+    }
+    drainPrune();
+}
+
+// For when a cell must come back into play (a wall was removed, or the
+// mouse or a goal is in an excluded cell): pruning restarts and every
+// distance field is reflooded.
+static void restorePruned(void) {
+    rebuildPruning();
+    clearRepairStack();
+    distancesValid = 0;
+    wallVersion += 1;
+    mapVersion += 1;
+}
+
+// Cells the active flood cannot reach while both the mouse and the start
+// can are cut off from all of them.
+static void pruneUnreachable(void) {
+    if (!pruningEnabled || pruneScanVersion == wallVersion || mouseIndex < 0 || distances[mouseIndex] < 0 ||
+        distances[pruneStartIndex] < 0) {
+        return;
+    }
+    pruneScanVersion = wallVersion;
+    for (int index = 0; index < cellCount; ++index) {
+        if (distances[index] < 0 && !isExcludedIndex(index) && !isAnchorIndex(index)) {
+            excludeCell(index);
         }
     }
+    drainPrune();
 }
 
 static void setBoundaryWalls(void) {
-    for (int x = 0; x < mazeWidth; ++x) {
-        horizontalWalls[0][x] = 1;
-        horizontalWalls[mazeHeight][x] = 1;
+    northWalls[mazeHeight - 1] = rowMask;
+    knownNorth[mazeHeight - 1] = rowMask;
+    for (int y = 0; y < mazeHeight; ++y) {
+        eastWalls[y] |= cellBit(mazeWidth - 1);
+        knownEast[y] |= cellBit(mazeWidth - 1);
+    }
+}
+
+#ifndef HEADLESS
+static void echoWall(FloodfillCell cell, char dirChar, int present) {
+    if (present) {
+        API_setWall(cell.x, cell.y, dirChar);
+    } else {
+        API_clearWall(cell.x, cell.y, dirChar);
     }
+}
+
+// Draws (or erases) every interior wall on the simulator display.
+static void drawKnownWalls(int present) {
     for (int y = 0; y < mazeHeight; ++y) {
-        verticalWalls[y][0] = 1;
-        verticalWalls[y][mazeWidth] = 1;
+        for (int x = 0; x < mazeWidth; ++x) {
+            WallRow bit = cellBit(x);
+            if (y + 1 < mazeHeight && (northWalls[y] & bit) != 0) {
+                echoWall((FloodfillCell){x, y}, 'n', present);
+            }
+            if (x + 1 < mazeWidth && (eastWalls[y] & bit) != 0) {
+                echoWall((FloodfillCell){x, y}, 'e', present);
+            }
+        }
+    }
+}
+#endif
+
+// Forgets every interior wall and visit, keeping only the outline.
+static void resetWalls(void) {
+    memset(wallWords, 0, 2 * mazeHeight * sizeof(*wallWords));
+    memset(knownWords, 0, 2 * mazeHeight * sizeof(*knownWords));
+    memset(sensedWords, 0, 2 * mazeHeight * sizeof(*sensedWords));
+    wallWords[2 * mazeHeight] = ~(WallRow)0;
+    knownWords[2 * mazeHeight] = ~(WallRow)0;
+    memset(visitedRows, 0, mazeHeight * sizeof(*visitedRows));
+    setBoundaryWalls();
+    restorePruned();
+}
+
+static void releaseStorage(void) {
+    free(fieldStorage);
+    free(wallWords);
+    free(knownWords);
+    free(sensedWords);
+    free(neighborIndex);
+    free(edgeSlots);
+    free(visitedRows);
+    free(closedNorth);
+    free(closedEast);
+    free(floodVisited);
+    free(floodFrontier);
+    free(floodNext);
+    free(repairStack);
+    free(repairQueued);
+    free(shownDistances);
+    free(specDistances);
+    free(excludedRows);
+    free(openDegree);
+    free(pruneStack);
+    free(pruneQueued);
+    free(specStamp);
+    free(specTouched);
+    free(predictIndex);
+    free(predictValue);
+    distances = NULL;
+    fieldStorage = NULL;
+    wallWords = NULL;
+    knownWords = NULL;
+    sensedWords = NULL;
+    neighborIndex = NULL;
+    edgeSlots = NULL;
+    northWalls = NULL;
+    eastWalls = NULL;
+    knownNorth = NULL;
+    knownEast = NULL;
+    visitedRows = NULL;
+    closedNorth = NULL;
+    closedEast = NULL;
+    floodVisited = NULL;
+    floodFrontier = NULL;
+    floodNext = NULL;
+    repairStack = NULL;
+    repairQueued = NULL;
+    shownDistances = NULL;
+    specDistances = NULL;
+    excludedRows = NULL;
+    openDegree = NULL;
+    pruneStack = NULL;
+    pruneQueued = NULL;
+    specStamp = NULL;
+    specTouched = NULL;
+    predictIndex = NULL;
+    predictValue = NULL;
+}
+
+// Sizes every per-cell array for the current maze. This is the only place
+// the module allocates, so the per-step path never does.
+static int allocateStorage(void) {
+    releaseStorage();
+    cellCount = mazeWidth * mazeHeight;
+    rowMask = (mazeWidth >= 64) ? ~(WallRow)0 : cellBit(mazeWidth) - 1;
+    fieldStorage = calloc((size_t)FLOODFILL_MAX_FIELDS * cellCount, sizeof(*fieldStorage));
+    wallWords = calloc(2 * mazeHeight + 1, sizeof(*wallWords));
+    knownWords = calloc(2 * mazeHeight + 1, sizeof(*knownWords));
+    sensedWords = calloc(2 * mazeHeight + 1, sizeof(*sensedWords));
+    neighborIndex = calloc(4 * cellCount, sizeof(*neighborIndex));
+    edgeSlots = calloc(4 * cellCount, sizeof(*edgeSlots));
+    visitedRows = calloc(mazeHeight, sizeof(*visitedRows));
+    closedNorth = calloc(mazeHeight, sizeof(*closedNorth));
+    closedEast = calloc(mazeHeight, sizeof(*closedEast));
+    floodVisited = calloc(mazeHeight, sizeof(*floodVisited));
+    floodFrontier = calloc(mazeHeight, sizeof(*floodFrontier));
+    floodNext = calloc(mazeHeight, sizeof(*floodNext));
+    repairStack = calloc(cellCount, sizeof(*repairStack));
+    repairQueued = calloc(cellCount, sizeof(*repairQueued));
+    shownDistances = calloc(cellCount, sizeof(*shownDistances));
+    specDistances = calloc(cellCount, sizeof(*specDistances));
+    excludedRows = calloc(mazeHeight, sizeof(*excludedRows));
+    openDegree = calloc(cellCount, sizeof(*openDegree));
+    pruneStack = calloc(cellCount, sizeof(*pruneStack));
+    pruneQueued = calloc(cellCount, sizeof(*pruneQueued));
+    specStamp = calloc(cellCount, sizeof(*specStamp));
+    specTouched = calloc(cellCount, sizeof(*specTouched));
+    predictIndex = calloc((size_t)OUTCOME_COUNT * cellCount, sizeof(*predictIndex));
+    predictValue = calloc((size_t)OUTCOME_COUNT * cellCount, sizeof(*predictValue));
+    if (fieldStorage == NULL || wallWords == NULL || knownWords == NULL || sensedWords == NULL ||
+        neighborIndex == NULL || edgeSlots == NULL || visitedRows == NULL || closedNorth == NULL ||
+        closedEast == NULL || floodVisited == NULL || floodFrontier == NULL || floodNext == NULL ||
+        repairStack == NULL || repairQueued == NULL || shownDistances == NULL ||
+        specDistances == NULL || specStamp == NULL || specTouched == NULL || predictIndex == NULL ||
+        predictValue == NULL || excludedRows == NULL || openDegree == NULL || pruneStack == NULL ||
+        pruneQueued == NULL) {
+        releaseStorage();
+        return 0;
     }
+    northWalls = wallWords;
+    eastWalls = wallWords + mazeHeight;
+    knownNorth = knownWords;
+    knownEast = knownWords + mazeHeight;
+    buildGeometry();
+    specGeneration = 0;
+    pruningEnabled = 0;
+    mouseIndex = -1;
+    predictionReady = 0;
+    committedDirection = NO_PREDICTION;
+    for (int i = 0; i < FLOODFILL_MAX_FIELDS; ++i) {
+        fields[i] = (DistanceField){.version = -1, .distances = fieldStorage + (size_t)i * cellCount};
+    }
+    activeField = -1;
+    distances = fields[0].distances;
+    return 1;
 }
 
-void Floodfill_init(void) {
+int Floodfill_init(void) {
+    moduleInitialized = 0;
     mazeWidth = API_mazeWidth();
     mazeHeight = API_mazeHeight();
-    if (mazeWidth > FLOODFILL_MAX_WIDTH) {
-        logMessage("Maze width exceeds FLOODFILL_MAX_WIDTH; truncating");
-        mazeWidth = FLOODFILL_MAX_WIDTH;
+    if (mazeWidth > FLOODFILL_MAX_WIDTH || mazeHeight > FLOODFILL_MAX_HEIGHT) {
+        // Reported even in headless builds: running on part of the maze
+        // would look like a solver bug rather than a size limit.
+        fprintf(stderr, "Maze is %dx%d but this build supports at most %dx%d\n",
+                mazeWidth, mazeHeight, FLOODFILL_MAX_WIDTH, FLOODFILL_MAX_HEIGHT);
+        fflush(stderr);
+        mazeWidth = 0;
+        mazeHeight = 0;
+        return 0;
+    }
+    if (mazeWidth <= 0 || mazeHeight <= 0) {
+        logMessage("Maze has no cells; floodfill disabled");
+        return 0;
     }
-    if (mazeHeight > FLOODFILL_MAX_HEIGHT) {
-        logMessage("Maze height exceeds FLOODFILL_MAX_HEIGHT; truncating");
-        mazeHeight = FLOODFILL_MAX_HEIGHT;
+    if (!allocateStorage()) {
+        logMessage("Floodfill storage allocation failed");
+        return 0;
     }
-    memset(horizontalWalls, 0, sizeof(horizontalWalls));
-    memset(verticalWalls, 0, sizeof(verticalWalls));
+    memset(&profile, 0, sizeof(profile));
+    repairStackSize = 0;
+    distancesValid = 0;
+    displayHidden = 0;
+    temporaryField = -1;
     clearAllDistances();
-    setBoundaryWalls();
+#ifndef HEADLESS
+    API_clearAllText();
+#endif
+    for (int y = 0; y < mazeHeight; ++y) {
+        for (int x = 0; x < mazeWidth; ++x) {
+            shownDistances[y * mazeWidth + x] = -1;
+        }
+    }
+    resetWalls();
     moduleInitialized = 1;
 
     FloodfillCell defaults[FLOODFILL_MAX_GOALS];
@@ -236,130 +754,1049 @@ void Floodfill_init(void) {
 
     Floodfill_setGoals(defaults, count);
     logMessage("Floodfill initialized");
+    return 1;
 }
 
-void Floodfill_setGoals(const FloodfillCell* goals, int goalCountInput) {
-    if (!moduleInitialized) {
-        return;
-    }
-    goalCellCount = 0;
-    if (goals == NULL || goalCountInput <= 0) {
-        logMessage("Floodfill_setGoals called with no goals");
-        return;
-    }
-    for (int i = 0; i < goalCountInput && goalCellCount < FLOODFILL_MAX_GOALS; ++i) {
+int Floodfill_mazeWidth(void) {
+    return mazeWidth;
+}
+
+int Floodfill_mazeHeight(void) {
+    return mazeHeight;
+}
+
+int Floodfill_cellCount(void) {
+    return cellCount;
+}
+
+// Copies the valid goals into out without duplicates; returns how many.
+static int collectGoals(const FloodfillCell* goals, int goalCount, FloodfillCell* out) {
+    int count = 0;
+    for (int i = 0; goals != NULL && i < goalCount && count < FLOODFILL_MAX_GOALS; ++i) {
         FloodfillCell candidate = goals[i];
         if (!isValidCell(candidate)) {
             continue;
         }
         bool duplicate = false;
-        for (int existing = 0; existing < goalCellCount; ++existing) {
-            if (goalCells[existing].x == candidate.x && goalCells[existing].y == candidate.y) {
+        for (int existing = 0; existing < count; ++existing) {
+            if (out[existing].x == candidate.x && out[existing].y == candidate.y) {
                 duplicate = true;
                 break;
             }
         }
         if (!duplicate) {
-            goalCells[goalCellCount++] = candidate;
+            out[count++] = candidate;
         }
     }
-    if (goalCellCount == 0) {
-        logMessage("Floodfill_setGoals found no valid goals");
-        return;
-    }
-    Floodfill_recalculate();
+    return count;
 }
 
-void Floodfill_markWall(FloodfillCell cell, API_Direction direction, int present) {
-    if (!moduleInitialized || !isValidCell(cell)) {
-        return;
-    }
-    unsigned char value = present ? 1 : 0;
-    unsigned char* slot = wallSlot(cell, direction);
-    if (slot == NULL) {
-        return;
-    }
-    if (present == 0 && isBoundaryEdge(cell, direction)) {
-        return;
-    }
-    if (*slot == value) {
-        return;
+// Goal lists compare as sets; both are free of duplicates.
+static int sameGoals(const DistanceField* field, const FloodfillCell* goals, int goalCount) {
+    if (field->goalCount != goalCount) {
+        return 0;
     }
-    *slot = value;
-    updateNeighborWall(cell, direction, value);
-    char dirChar = directionToChar(direction);
-    if (present) {
-        API_setWall(cell.x, cell.y, dirChar);
-    } else {
-        API_clearWall(cell.x, cell.y, dirChar);
+    for (int i = 0; i < goalCount; ++i) {
+        int found = 0;
+        for (int j = 0; j < field->goalCount && !found; ++j) {
+            found = field->goals[j].x == goals[i].x && field->goals[j].y == goals[i].y;
+        }
+        if (!found) {
+            return 0;
+        }
     }
+    return 1;
 }
 
-void Floodfill_recalculate(void) {
-    if (!moduleInitialized || goalCellCount == 0) {
-        return;
-    }
-    clearAllDistances();
+static long currentVersion(FloodfillAssumption assumption) {
+    return (assumption == FLOODFILL_UNKNOWN_WALL) ? mapVersion : wallVersion;
+}
 
-    FloodfillQueue queue;
-    queueInit(&queue);
+static int isFieldCurrent(const DistanceField* field) {
+    return field->version == currentVersion(field->assumption);
+}
 
-    for (int i = 0; i < goalCellCount; ++i) {
-        FloodfillCell goal = goalCells[i];
-        if (!isValidCell(goal)) {
-            continue;
+static int findGoalField(const FloodfillCell* goals, int goalCount, FloodfillAssumption assumption, int unnamedOnly) {
+    for (int i = 0; i < FLOODFILL_MAX_FIELDS; ++i) {
+        const DistanceField* field = &fields[i];
+        if (field->inUse && field->assumption == assumption && !(unnamedOnly && field->name[0] != '\0') &&
+            sameGoals(field, goals, goalCount)) {
+            return i;
         }
-        distances[goal.y][goal.x] = 0;
-        displayDistance(goal, 0);
-        queuePush(&queue, goal);
     }
+    return -1;
+}
 
-    while (!queueIsEmpty(&queue)) {
-        FloodfillCell current = queuePop(&queue);
-        int currentDistance = distances[current.y][current.x];
-        for (API_Direction dir = API_DIR_NORTH; dir <= API_DIR_WEST; dir = (API_Direction)(dir + 1)) {
-            if (hasWallBetween(current, dir)) {
-                continue;
-            }
-            FloodfillCell neighbor = neighborCell(current, dir);
-            if (!isValidCell(neighbor)) {
-                continue;
-            }
-            if (distances[neighbor.y][neighbor.x] != -1) {
-                continue;
-            }
-            distances[neighbor.y][neighbor.x] = currentDistance + 1;
-            displayDistance(neighbor, distances[neighbor.y][neighbor.x]);
-            queuePush(&queue, neighbor);
+static int namedFieldCount(void) {
+    int count = 0;
+    for (int i = 0; i < FLOODFILL_MAX_FIELDS; ++i) {
+        count += fields[i].inUse && fields[i].name[0] != '\0';
+    }
+    return count;
+}
+
+// A free field, otherwise the least recently used unnamed one other than
+// avoid. Floodfill_defineField always leaves two fields unnamed, so there is
+// one.
+static int claimUnnamedField(int avoid) {
+    int best = -1;
+    for (int i = 0; i < FLOODFILL_MAX_FIELDS; ++i) {
+        const DistanceField* field = &fields[i];
+        if (!field->inUse) {
+            return i;
+        }
+        if (i != avoid && field->name[0] == '\0' && (best < 0 || field->lastUsed < fields[best].lastUsed)) {
+            best = i;
         }
     }
+    return best;
 }
 
-int Floodfill_distanceAt(FloodfillCell cell) {
-    if (!moduleInitialized || !isValidCell(cell)) {
-        return -1;
+static void setFieldGoals(int index, const FloodfillCell* goals, int goalCount, FloodfillAssumption assumption) {
+    DistanceField* field = &fields[index];
+    field->inUse = 1;
+    field->name[0] = '\0';
+    memcpy(field->goals, goals, goalCount * sizeof(*goals));
+    field->goalCount = goalCount;
+    field->assumption = assumption;
+    field->version = -1;
+    // A prediction made for this slot's old goals no longer applies.
+    if (index == predictField) {
+        predictionReady = 0;
+        committedDirection = NO_PREDICTION;
     }
-    return distances[cell.y][cell.x];
 }
 
-int Floodfill_canMove(FloodfillCell cell, API_Direction direction) {
-    if (!moduleInitialized || !isValidCell(cell)) {
-        return 0;
+// Makes a field the one Floodfill_distanceAt and incremental repair use. A
+// field still current for the walls needs no flood at all.
+static void activateField(int index) {
+    DistanceField* field = &fields[index];
+    field->lastUsed = ++fieldClock;
+    if (index == activeField) {
+        return;
     }
-    if (hasWallBetween(cell, direction)) {
-        return 0;
+    clearRepairStack();
+    // The old goals stop being anchors and may now be dead ends.
+    for (int i = 0; i < goalCellCount; ++i) {
+        queuePrune(cellIndex(goalCells[i]));
     }
-    FloodfillCell neighbor = neighborCell(cell, direction);
-    if (!isValidCell(neighbor)) {
-        return 0;
+    activeField = index;
+    distances = field->distances;
+    memcpy(goalCells, field->goals, field->goalCount * sizeof(*goalCells));
+    goalCellCount = field->goalCount;
+    distancesValid = isFieldCurrent(field);
+    displayStale = 1;
+    for (int i = 0; i < goalCellCount; ++i) {
+        if (isExcludedIndex(cellIndex(goalCells[i]))) {
+            logMessage("Goal is in a pruned cell; restoring pruned cells");
+            restorePruned();
+            return;
+        }
     }
-    return 1;
+    drainPrune();
 }
 
-FloodfillCell Floodfill_neighbor(FloodfillCell cell, API_Direction direction) {
-    FloodfillCell neighbor = neighborCell(cell, direction);
-    if (!moduleInitialized || !isValidCell(neighbor)) {
-        return (FloodfillCell){-1, -1};
+// Temporary goals reuse one unnamed field, so chasing a string of them does
+// not push the cached goal sets out of the table.
+static int claimTemporaryField(void) {
+    if (temporaryField >= 0 && fields[temporaryField].inUse && fields[temporaryField].name[0] == '\0') {
+        return temporaryField;
     }
-    return neighbor;
+    temporaryField = claimUnnamedField(-1);
+    return temporaryField;
+}
+
+static void setGoals(const FloodfillCell* goals, int goalCountInput, int temporary) {
+    if (!moduleInitialized) {
+        return;
+    }
+    if (goals == NULL || goalCountInput <= 0) {
+        goalCellCount = 0;
+        activeField = -1;
+        logMessage("Floodfill_setGoals called with no goals");
+        return;
+    }
+    FloodfillCell unique[FLOODFILL_MAX_GOALS];
+    int count = collectGoals(goals, goalCountInput, unique);
+    if (count == 0) {
+        goalCellCount = 0;
+        activeField = -1;
+        logMessage("Floodfill_setGoals found no valid goals");
+        return;
+    }
+    int index = findGoalField(unique, count, FLOODFILL_UNKNOWN_OPEN, 0);
+    if (index < 0) {
+        index = temporary ? claimTemporaryField() : claimUnnamedField(-1);
+        if (index == activeField) {
+            activeField = -1;
+        }
+        setFieldGoals(index, unique, count, FLOODFILL_UNKNOWN_OPEN);
+    }
+    if (displayHidden != temporary) {
+        displayHidden = temporary;
+        displayStale = 1;
+    }
+    activateField(index);
+    Floodfill_recalculate();
+}
+
+void Floodfill_setGoals(const FloodfillCell* goals, int goalCountInput) {
+    setGoals(goals, goalCountInput, 0);
+}
+
+void Floodfill_setTemporaryGoals(const FloodfillCell* goals, int goalCountInput) {
+    setGoals(goals, goalCountInput, 1);
+}
+
+void Floodfill_markWall(FloodfillCell cell, API_Direction direction, int present) {
+    if (!moduleInitialized || !isValidCell(cell)) {
+        return;
+    }
+    int index = cellIndex(cell);
+    int neighbor = neighborIndex[edgeKey(index, direction)];
+    // The maze outline stays a wall whatever the sensors claim.
+    if (neighbor < 0) {
+        return;
+    }
+    if (markEdgeKnown(index, direction)) {
+        refreshVisited(index);
+        refreshVisited(neighbor);
+    }
+    if (hasWallAt(index, direction) == (present != 0)) {
+        return;
+    }
+    EdgeSlot slot = edgeSlots[edgeKey(index, direction)];
+    wallWords[slot.word] ^= cellBit(slot.bit);
+    wallVersion += 1;
+    mapVersion += 1;
+    queueRepair(index);
+    queueRepair(neighbor);
+    if (isExcludedIndex(index) || isExcludedIndex(neighbor)) {
+        if (!present) {
+            restorePruned();
+        }
+    } else {
+        openDegree[index] += present ? -1 : 1;
+        openDegree[neighbor] += present ? -1 : 1;
+        queuePrune(index);
+        queuePrune(neighbor);
+        drainPrune();
+    }
+#ifndef HEADLESS
+    echoWall(cell, directionToChar(direction), present);
+#endif
+}
+
+static int lowestBitIndex(WallRow bits) {
+#if defined(__GNUC__)
+    return __builtin_ctzll(bits);
+#else
+    int index = 0;
+    while ((bits & 1) == 0) {
+        bits >>= 1;
+        index += 1;
+    }
+    return index;
+#endif
+}
+
+// Breadth-first flood that advances a whole row of the frontier per word:
+// each level spreads every frontier bit east, west, north and south at once,
+// masked by the walls on that side, then numbers the newly reached cells.
+// Touches nothing but its arguments, so a snapshot can be flooded on another
+// thread. Cells set in excluded are never entered. Returns the number of
+// cells reached.
+static long floodWithScratch(const FloodfillCell* goals,
+                             int goalCount,
+                             const WallRow* north,
+                             const WallRow* east,
+                             const WallRow* excluded,
+                             int* out,
+                             const FloodScratch* scratch) {
+    WallRow* floodVisited = scratch->visited;
+    WallRow* floodFrontier = scratch->frontier;
+    WallRow* floodNext = scratch->next;
+    for (int i = 0; i < cellCount; ++i) {
+        out[i] = -1;
+    }
+    memset(floodVisited, 0, mazeHeight * sizeof(*floodVisited));
+    memset(floodFrontier, 0, mazeHeight * sizeof(*floodFrontier));
+
+    long relaxed = 0;
+    int lowRow = mazeHeight;
+    int highRow = -1;
+    for (int i = 0; i < goalCount; ++i) {
+        FloodfillCell goal = goals[i];
+        if (!isValidCell(goal)) {
+            continue;
+        }
+        out[cellIndex(goal)] = 0;
+        floodFrontier[goal.y] |= cellBit(goal.x);
+        floodVisited[goal.y] |= cellBit(goal.x);
+        if (goal.y < lowRow) {
+            lowRow = goal.y;
+        }
+        if (goal.y > highRow) {
+            highRow = goal.y;
+        }
+    }
+
+    for (int level = 1; lowRow <= highRow; ++level) {
+        int spreadLow = (lowRow > 0) ? lowRow - 1 : 0;
+        int spreadHigh = (highRow < mazeHeight - 1) ? highRow + 1 : mazeHeight - 1;
+        memset(floodNext + spreadLow, 0, (spreadHigh - spreadLow + 1) * sizeof(*floodNext));
+        for (int y = lowRow; y <= highRow; ++y) {
+            WallRow frontier = floodFrontier[y];
+            if (frontier == 0) {
+                continue;
+            }
+            floodNext[y] |= ((frontier & ~east[y]) << 1) | ((frontier >> 1) & ~east[y]);
+            if (y + 1 < mazeHeight) {
+                floodNext[y + 1] |= frontier & ~north[y];
+            }
+            if (y > 0) {
+                floodNext[y - 1] |= frontier & ~north[y - 1];
+            }
+        }
+
+        int nextLow = mazeHeight;
+        int nextHigh = -1;
+        for (int y = spreadLow; y <= spreadHigh; ++y) {
+            WallRow reached = floodNext[y] & rowMask & ~floodVisited[y] & ~excluded[y];
+            floodFrontier[y] = reached;
+            if (reached == 0) {
+                continue;
+            }
+            floodVisited[y] |= reached;
+            if (y < nextLow) {
+                nextLow = y;
+            }
+            nextHigh = y;
+            int* rowDistances = out + y * mazeWidth;
+            while (reached != 0) {
+                rowDistances[lowestBitIndex(reached)] = level;
+                reached &= reached - 1;
+                relaxed += 1;
+            }
+        }
+        lowRow = nextLow;
+        highRow = nextHigh;
+    }
+    return relaxed;
+}
+
+static void floodInto(const FloodfillCell* goals,
+                      int goalCount,
+                      const WallRow* north,
+                      const WallRow* east,
+                      int* out) {
+    FloodScratch scratch = {floodVisited, floodFrontier, floodNext};
+    Stats_addCellsRelaxed(floodWithScratch(goals, goalCount, north, east, excludedRows, out, &scratch));
+}
+
+static void floodFromGoals(void) {
+    profile.fullFloods += 1;
+    clearRepairStack();
+    floodInto(goalCells, goalCellCount, northWalls, eastWalls, distances);
+    distancesValid = 1;
+}
+
+// Closes every edge that has not been seen.
+static void buildClosedWalls(void) {
+    for (int y = 0; y < mazeHeight; ++y) {
+        closedEast[y] = eastWalls[y] | (~knownEast[y] & rowMask);
+        closedNorth[y] = northWalls[y] | (~knownNorth[y] & rowMask);
+    }
+}
+
+static void floodField(DistanceField* field) {
+    if (field->assumption == FLOODFILL_UNKNOWN_WALL) {
+        buildClosedWalls();
+        floodInto(field->goals, field->goalCount, closedNorth, closedEast, field->distances);
+    } else {
+        floodInto(field->goals, field->goalCount, northWalls, eastWalls, field->distances);
+    }
+    field->version = currentVersion(field->assumption);
+}
+
+static void recalculate(void) {
+    if (!distancesValid) {
+        floodFromGoals();
+        publishDistances();
+        return;
+    }
+    if (repairStackSize == 0) {
+        if (displayStale) {
+            publishDistances();
+        }
+        return;
+    }
+    if (!repairDistances()) {
+        logMessage("Floodfill repair exceeded budget; reflooding");
+        floodFromGoals();
+    }
+    publishDistances();
+}
+
+void Floodfill_recalculate(void) {
+    if (!moduleInitialized || goalCellCount == 0) {
+        return;
+    }
+    profile.recalculations += 1;
+    double wallStarted = Stats_now();
+#ifdef BENCHMARK
+    clock_t started = clock();
+    recalculate();
+    profile.cpuSeconds += (double)(clock() - started) / CLOCKS_PER_SEC;
+#else
+    recalculate();
+#endif
+    fields[activeField].version = wallVersion;
+    pruneUnreachable();
+    Stats_addRecalculation(Stats_now() - wallStarted);
+}
+
+int Floodfill_distanceAt(FloodfillCell cell) {
+    if (!moduleInitialized || !isValidCell(cell)) {
+        return -1;
+    }
+    return distances[cellIndex(cell)];
+}
+
+int Floodfill_canMove(FloodfillCell cell, API_Direction direction) {
+    if (!moduleInitialized || !isValidCell(cell)) {
+        return 0;
+    }
+    return !hasWallAt(cellIndex(cell), direction);
+}
+
+FloodfillCell Floodfill_neighbor(FloodfillCell cell, API_Direction direction) {
+    if (!moduleInitialized || !isValidCell(cell)) {
+        return (FloodfillCell){-1, -1};
+    }
+    int neighbor = neighborIndex[edgeKey(cellIndex(cell), direction)];
+    return neighbor < 0 ? (FloodfillCell){-1, -1} : indexCell(neighbor);
+}
+
+void Floodfill_markVisited(FloodfillCell cell) {
+    if (!moduleInitialized || !isValidCell(cell)) {
+        return;
+    }
+    int index = cellIndex(cell);
+    for (API_Direction dir = API_DIR_NORTH; dir <= API_DIR_WEST; dir = (API_Direction)(dir + 1)) {
+        if (markEdgeKnown(index, dir)) {
+            refreshVisited(neighborIndex[edgeKey(index, dir)]);
+        }
+    }
+    visitedRows[cell.y] |= cellBit(cell.x);
+}
+
+int Floodfill_isVisited(FloodfillCell cell) {
+    if (!moduleInitialized || !isValidCell(cell)) {
+        return 0;
+    }
+    return (visitedRows[cell.y] & cellBit(cell.x)) != 0;
+}
+
+FloodfillWallState Floodfill_wallState(FloodfillCell cell, API_Direction direction) {
+    if (!moduleInitialized || !isValidCell(cell) || hasWallAt(cellIndex(cell), direction)) {
+        return FLOODFILL_WALL_PRESENT;
+    }
+    return isEdgeKnownAt(cellIndex(cell), direction) ? FLOODFILL_WALL_OPEN : FLOODFILL_WALL_UNKNOWN;
+}
+
+int Floodfill_isKnownOpen(FloodfillCell cell, API_Direction direction) {
+    return Floodfill_wallState(cell, direction) == FLOODFILL_WALL_OPEN;
+}
+
+int Floodfill_isSensedOpen(FloodfillCell cell, API_Direction direction) {
+    if (!Floodfill_isKnownOpen(cell, direction)) {
+        return 0;
+    }
+    EdgeSlot slot = edgeSlots[edgeKey(cellIndex(cell), direction)];
+    return (int)(sensedWords[slot.word] >> slot.bit) & 1;
+}
+
+int Floodfill_rotationCost(API_Direction target, API_Direction heading) {
+    int diff = (target - heading + 4) % 4;
+    return (diff == 2) ? 2 : (diff != 0);
+}
+
+// Steepest descent with the fewest quarter turns as the tie-break; if no
+// neighbour is closer, the nearest reachable one.
+static API_Direction chooseDirection(int index, API_Direction heading, const DistanceAccess* access) {
+    int currentDistance = access->get(index);
+    const int* neighbors = neighborIndex + edgeKey(index, API_DIR_NORTH);
+    int bestDistance = INT_MAX;
+    int bestRotation = INT_MAX;
+    API_Direction bestDirection = heading;
+    int foundBetter = 0;
+
+    for (API_Direction dir = API_DIR_NORTH; dir <= API_DIR_WEST; dir = (API_Direction)(dir + 1)) {
+        if (hasWallAt(index, dir) || isExcludedIndex(neighbors[dir])) {
+            continue;
+        }
+        int neighborDistance = access->get(neighbors[dir]);
+        if (neighborDistance < 0) {
+            continue;
+        }
+        int rotCost = Floodfill_rotationCost(dir, heading);
+        if (currentDistance >= 0 && neighborDistance < currentDistance) {
+            if (!foundBetter || neighborDistance < bestDistance ||
+                (neighborDistance == bestDistance && rotCost < bestRotation)) {
+                foundBetter = 1;
+                bestDistance = neighborDistance;
+                bestRotation = rotCost;
+                bestDirection = dir;
+            }
+            continue;
+        }
+        if (foundBetter) {
+            continue;
+        }
+        if (neighborDistance < bestDistance || (neighborDistance == bestDistance && rotCost < bestRotation)) {
+            bestDistance = neighborDistance;
+            bestRotation = rotCost;
+            bestDirection = dir;
+        }
+    }
+    return bestDirection;
+}
+
+API_Direction Floodfill_bestDirection(FloodfillCell cell, API_Direction heading) {
+    if (!moduleInitialized || !isValidCell(cell)) {
+        return heading;
+    }
+    return chooseDirection(cellIndex(cell), heading, &ACTIVE_DISTANCES);
+}
+
+static int overlayDistance(int index) {
+    return (specStamp[index] == specGeneration) ? specDistances[index] : distances[index];
+}
+
+static void setOverlayDistance(int index, int value) {
+    if (specStamp[index] != specGeneration) {
+        specStamp[index] = specGeneration;
+        specTouched[specTouchedCount++] = index;
+    }
+    specDistances[index] = value;
+}
+
+static const DistanceAccess OVERLAY_DISTANCES = {overlayDistance, setOverlayDistance};
+
+static void beginOverlay(void) {
+    specTouchedCount = 0;
+    specGeneration += 1;
+    if (specGeneration == 0) {
+        memset(specStamp, 0, cellCount * sizeof(*specStamp));
+        specGeneration = 1;
+    }
+}
+
+// Directions of the front, left and right sensors, in API_WALL_* bit order.
+static void sensorDirections(API_Direction heading, API_Direction* directions) {
+    directions[0] = heading;
+    directions[1] = (API_Direction)((heading + 3) % 4);
+    directions[2] = (API_Direction)((heading + 1) % 4);
+}
+
+static const int SENSOR_BITS[3] = {API_WALL_FRONT, API_WALL_LEFT, API_WALL_RIGHT};
+
+// Lists the edges an outcome would flip, or returns -1 if it contradicts a
+// known wall or claims an opening in the outline.
+static int outcomeChanges(int index, API_Direction heading, int outcome, API_Direction* changed) {
+    API_Direction directions[3];
+    sensorDirections(heading, directions);
+    int count = 0;
+    for (int i = 0; i < 3; ++i) {
+        int present = (outcome & SENSOR_BITS[i]) != 0;
+        int wall = hasWallAt(index, directions[i]);
+        if (neighborIndex[edgeKey(index, directions[i])] < 0 || isEdgeKnownAt(index, directions[i])) {
+            if (wall != present) {
+                return -1;
+            }
+            continue;
+        }
+        if (wall != present) {
+            changed[count++] = directions[i];
+        }
+    }
+    return count;
+}
+
+static void toggleWall(int index, API_Direction direction) {
+    EdgeSlot slot = edgeSlots[edgeKey(index, direction)];
+    wallWords[slot.word] ^= cellBit(slot.bit);
+}
+
+void Floodfill_predictOutcomes(FloodfillCell cell, API_Direction heading) {
+    predictionReady = 0;
+    committedDirection = NO_PREDICTION;
+    if (!moduleInitialized || !isValidCell(cell) || goalCellCount == 0 || !distancesValid ||
+        repairStackSize != 0 || fields[activeField].version != wallVersion) {
+        return;
+    }
+    int index = cellIndex(cell);
+    int used = 0;
+    for (int outcome = 0; outcome < OUTCOME_COUNT; ++outcome) {
+        predictDirection[outcome] = NO_PREDICTION;
+        API_Direction changed[3];
+        int changeCount = outcomeChanges(index, heading, outcome, changed);
+        if (changeCount < 0) {
+            continue;
+        }
+        // Flip the walls in place, repair through the overlay, then flip
+        // them back; the live distances are never written.
+        beginOverlay();
+        for (int i = 0; i < changeCount; ++i) {
+            toggleWall(index, changed[i]);
+            queueRepair(index);
+            queueRepair(neighborIndex[edgeKey(index, changed[i])]);
+        }
+        long relaxed = 0;
+        if (repairWith(FLOODFILL_PREDICT_BUDGET, &OVERLAY_DISTANCES, &relaxed)) {
+            predictDirection[outcome] = chooseDirection(index, heading, &OVERLAY_DISTANCES);
+            predictStart[outcome] = used;
+            predictLength[outcome] = specTouchedCount;
+            predictToggles[outcome] = changeCount;
+            for (int i = 0; i < specTouchedCount; ++i) {
+                predictIndex[used] = specTouched[i];
+                predictValue[used] = specDistances[specTouched[i]];
+                used += 1;
+            }
+        }
+        for (int i = 0; i < changeCount; ++i) {
+            toggleWall(index, changed[i]);
+        }
+    }
+    predictionReady = 1;
+    predictCell = index;
+    predictHeading = heading;
+    predictVersion = wallVersion;
+    predictField = activeField;
+}
+
+int Floodfill_commitPrediction(int walls) {
+    if (!predictionReady) {
+        return 0;
+    }
+    predictionReady = 0;
+    int outcome = walls & (API_WALL_FRONT | API_WALL_LEFT | API_WALL_RIGHT);
+    if (predictDirection[outcome] == NO_PREDICTION || activeField != predictField ||
+        wallVersion != predictVersion + predictToggles[outcome]) {
+        return 0;
+    }
+    // The only wall changes since the prediction must be this outcome's.
+    API_Direction directions[3];
+    sensorDirections(predictHeading, directions);
+    for (int i = 0; i < 3; ++i) {
+        if (hasWallAt(predictCell, directions[i]) != ((outcome & SENSOR_BITS[i]) != 0)) {
+            return 0;
+        }
+    }
+    clearRepairStack();
+    // Cells pruned by the sensed walls keep the -1 they were given.
+    for (int i = predictStart[outcome]; i < predictStart[outcome] + predictLength[outcome]; ++i) {
+        if (!isExcludedIndex(predictIndex[i])) {
+            distances[predictIndex[i]] = predictValue[i];
+        }
+    }
+    distancesValid = 1;
+    fields[activeField].version = wallVersion;
+    profile.adoptedFloods += 1;
+    committedDirection = predictDirection[outcome];
+    committedVersion = wallVersion;
+    pruneUnreachable();
+    publishDistances();
+    return 1;
+}
+
+int Floodfill_predictedDirection(FloodfillCell cell, API_Direction heading, API_Direction* direction) {
+    if (committedDirection == NO_PREDICTION || !isValidCell(cell) || cellIndex(cell) != predictCell ||
+        heading != predictHeading || activeField != predictField || wallVersion != committedVersion) {
+        return 0;
+    }
+    if (isExcludedIndex(neighborIndex[edgeKey(predictCell, (API_Direction)committedDirection)])) {
+        return 0;
+    }
+    *direction = (API_Direction)committedDirection;
+    return 1;
+}
+
+int Floodfill_floodDistances(const FloodfillCell* goals,
+                             int goalCount,
+                             FloodfillAssumption assumption,
+                             int* out) {
+    if (!moduleInitialized) {
+        return 0;
+    }
+    if (assumption == FLOODFILL_UNKNOWN_WALL) {
+        buildClosedWalls();
+        floodInto(goals, goalCount, closedNorth, closedEast, out);
+    } else {
+        floodInto(goals, goalCount, northWalls, eastWalls, out);
+    }
+    return 1;
+}
+
+FloodfillField Floodfill_findField(const char* name) {
+    if (!moduleInitialized || name == NULL || name[0] == '\0') {
+        return -1;
+    }
+    for (int i = 0; i < FLOODFILL_MAX_FIELDS; ++i) {
+        if (fields[i].inUse && strncmp(fields[i].name, name, FLOODFILL_FIELD_NAME_SIZE - 1) == 0) {
+            return i;
+        }
+    }
+    return -1;
+}
+
+FloodfillField Floodfill_defineField(const char* name,
+                                     const FloodfillCell* goals,
+                                     int goalCount,
+                                     FloodfillAssumption assumption) {
+    if (!moduleInitialized || name == NULL || name[0] == '\0') {
+        return -1;
+    }
+    FloodfillCell unique[FLOODFILL_MAX_GOALS];
+    int count = collectGoals(goals, goalCount, unique);
+    if (count == 0) {
+        logMessage("Floodfill_defineField found no valid goals");
+        return -1;
+    }
+    int index = Floodfill_findField(name);
+    if (index >= 0) {
+        if (fields[index].assumption == assumption && sameGoals(&fields[index], unique, count)) {
+            return index;
+        }
+        if (index == activeField) {
+            logMessage("Floodfill_defineField cannot change the goals in use");
+            return -1;
+        }
+        setFieldGoals(index, unique, count, assumption);
+    } else {
+        if (namedFieldCount() >= FLOODFILL_MAX_FIELDS - 2) {
+            logMessage("Floodfill field table is full");
+            return -1;
+        }
+        // An unnamed field with these goals already holds their distances.
+        index = findGoalField(unique, count, assumption, 1);
+        if (index < 0) {
+            index = claimUnnamedField(activeField);
+            setFieldGoals(index, unique, count, assumption);
+        }
+    }
+    snprintf(fields[index].name, FLOODFILL_FIELD_NAME_SIZE, "%s", name);
+    return index;
+}
+
+const int* Floodfill_fieldDistances(FloodfillField field) {
+    if (!moduleInitialized || field < 0 || field >= FLOODFILL_MAX_FIELDS || !fields[field].inUse) {
+        return NULL;
+    }
+    fields[field].lastUsed = ++fieldClock;
+    if (field == activeField) {
+        Floodfill_recalculate();
+        return distances;
+    }
+    if (!isFieldCurrent(&fields[field])) {
+        floodField(&fields[field]);
+    }
+    return fields[field].distances;
+}
+
+FloodfillSnapshot* Floodfill_newSnapshot(void) {
+    if (!moduleInitialized) {
+        return NULL;
+    }
+    FloodfillSnapshot* snapshot = calloc(1, sizeof(*snapshot));
+    if (snapshot == NULL) {
+        return NULL;
+    }
+    snapshot->wordCount = 2 * mazeHeight + 1;
+    snapshot->walls = calloc(snapshot->wordCount, sizeof(*snapshot->walls));
+    snapshot->work = calloc(snapshot->wordCount, sizeof(*snapshot->work));
+    snapshot->excluded = calloc(mazeHeight, sizeof(WallRow));
+    snapshot->scratch.visited = calloc(mazeHeight, sizeof(WallRow));
+    snapshot->scratch.frontier = calloc(mazeHeight, sizeof(WallRow));
+    snapshot->scratch.next = calloc(mazeHeight, sizeof(WallRow));
+    if (snapshot->walls == NULL || snapshot->work == NULL || snapshot->excluded == NULL ||
+        snapshot->scratch.visited == NULL ||
+        snapshot->scratch.frontier == NULL || snapshot->scratch.next == NULL) {
+        Floodfill_freeSnapshot(snapshot);
+        return NULL;
+    }
+    return snapshot;
+}
+
+void Floodfill_freeSnapshot(FloodfillSnapshot* snapshot) {
+    if (snapshot == NULL) {
+        return;
+    }
+    free(snapshot->walls);
+    free(snapshot->work);
+    free(snapshot->excluded);
+    free(snapshot->scratch.visited);
+    free(snapshot->scratch.frontier);
+    free(snapshot->scratch.next);
+    free(snapshot);
+}
+
+int Floodfill_takeSnapshot(FloodfillSnapshot* snapshot, FloodfillCell cell, API_Direction heading) {
+    if (!moduleInitialized || snapshot == NULL || !isValidCell(cell) || goalCellCount == 0) {
+        return 0;
+    }
+    memcpy(snapshot->walls, wallWords, snapshot->wordCount * sizeof(*wallWords));
+    memcpy(snapshot->excluded, excludedRows, mazeHeight * sizeof(*excludedRows));
+    memcpy(snapshot->goals, goalCells, goalCellCount * sizeof(*goalCells));
+    snapshot->goalCount = goalCellCount;
+    snapshot->cell = cell;
+    snapshot->heading = heading;
+    return 1;
+}
+
+// Fills the snapshot's work rows with its walls plus the sensed ones, as
+// Main records them: front, left and right from the bits, and the edge the
+// mouse came in through open. The outline is never opened.
+static void applyOutcome(FloodfillSnapshot* snapshot, int walls) {
+    memcpy(snapshot->work, snapshot->walls, snapshot->wordCount * sizeof(*snapshot->work));
+    int index = cellIndex(snapshot->cell);
+    API_Direction heading = snapshot->heading;
+    const API_Direction directions[4] = {
+        heading,
+        (API_Direction)((heading + 3) % 4),
+        (API_Direction)((heading + 1) % 4),
+        (API_Direction)((heading + 2) % 4),
+    };
+    const int present[4] = {walls & API_WALL_FRONT, walls & API_WALL_LEFT, walls & API_WALL_RIGHT, 0};
+    for (int i = 0; i < 4; ++i) {
+        if (neighborIndex[edgeKey(index, directions[i])] < 0) {
+            continue;
+        }
+        EdgeSlot slot = edgeSlots[edgeKey(index, directions[i])];
+        if (present[i]) {
+            snapshot->work[slot.word] |= cellBit(slot.bit);
+        } else {
+            snapshot->work[slot.word] &= ~cellBit(slot.bit);
+        }
+    }
+}
+
+void Floodfill_floodSnapshot(FloodfillSnapshot* snapshot, int walls, int* out) {
+    applyOutcome(snapshot, walls);
+    floodWithScratch(snapshot->goals, snapshot->goalCount, snapshot->work, snapshot->work + mazeHeight,
+                     snapshot->excluded, out, &snapshot->scratch);
+}
+
+int Floodfill_adoptSnapshotFlood(FloodfillSnapshot* snapshot, int walls, const int* flooded) {
+    if (!moduleInitialized || snapshot == NULL || activeField < 0 ||
+        !sameGoals(&fields[activeField], snapshot->goals, snapshot->goalCount)) {
+        return 0;
+    }
+    applyOutcome(snapshot, walls);
+    if (memcmp(snapshot->work, wallWords, snapshot->wordCount * sizeof(*wallWords)) != 0) {
+        return 0;
+    }
+    // The flood stands if pruning has only grown since the snapshot; cells
+    // pruned since then are blanked.
+    for (int y = 0; y < mazeHeight; ++y) {
+        if (snapshot->excluded[y] & ~excludedRows[y]) {
+            return 0;
+        }
+    }
+    clearRepairStack();
+    memcpy(distances, flooded, cellCount * sizeof(*distances));
+    for (int y = 0; y < mazeHeight; ++y) {
+        WallRow pruned = excludedRows[y] & ~snapshot->excluded[y];
+        while (pruned != 0) {
+            distances[y * mazeWidth + lowestBitIndex(pruned)] = -1;
+            pruned &= pruned - 1;
+        }
+    }
+    distancesValid = 1;
+    fields[activeField].version = wallVersion;
+    profile.adoptedFloods += 1;
+    publishDistances();
+    return 1;
+}
+
+static WallRow* mapRows(int index) {
+    WallRow* arrays[MAP_ROW_ARRAYS] = {northWalls, eastWalls, knownNorth, knownEast};
+    return arrays[index];
+}
+
+int Floodfill_saveMap(const char* path) {
+    if (!moduleInitialized || path == NULL) {
+        return 0;
+    }
+    FILE* file = fopen(path, "wb");
+    if (file == NULL) {
+        logMessage("Unable to open map file for writing");
+        return 0;
+    }
+    unsigned char header[MAP_HEADER_SIZE] = {
+        MAP_MAGIC[0], MAP_MAGIC[1], MAP_MAGIC[2], MAP_MAGIC[3],
+        MAP_VERSION, (unsigned char)mazeWidth, (unsigned char)mazeHeight, 0,
+    };
+    int ok = fwrite(header, 1, sizeof(header), file) == sizeof(header);
+    for (int array = 0; ok && array < MAP_ROW_ARRAYS; ++array) {
+        const WallRow* rows = mapRows(array);
+        for (int y = 0; ok && y < mazeHeight; ++y) {
+            unsigned char bytes[8];
+            for (int i = 0; i < 8; ++i) {
+                bytes[i] = (unsigned char)(rows[y] >> (8 * i));
+            }
+            ok = fwrite(bytes, 1, sizeof(bytes), file) == sizeof(bytes);
+        }
+    }
+    if (fclose(file) != 0) {
+        ok = 0;
+    }
+    if (!ok) {
+        logMessage("Failed to write map file");
+    }
+    return ok;
+}
+
+int Floodfill_loadMap(const char* path) {
+    if (!moduleInitialized || path == NULL) {
+        return 0;
+    }
+    FILE* file = fopen(path, "rb");
+    if (file == NULL) {
+        return 0;
+    }
+    unsigned char header[MAP_HEADER_SIZE];
+    if (fread(header, 1, sizeof(header), file) != sizeof(header) ||
+        memcmp(header, MAP_MAGIC, 4) != 0 || header[4] != MAP_VERSION) {
+        logMessage("Map file is not a saved maze map; ignoring it");
+        fclose(file);
+        return 0;
+    }
+    if (header[5] != mazeWidth || header[6] != mazeHeight) {
+        logMessage("Map file is for a different maze size; ignoring it");
+        fclose(file);
+        return 0;
+    }
+    // Read everything before touching the live rows so a short file changes
+    // nothing.
+    size_t size = (size_t)MAP_ROW_ARRAYS * mazeHeight * 8;
+    unsigned char* bytes = malloc(size);
+    int ok = bytes != NULL && fread(bytes, 1, size, file) == size && fgetc(file) == EOF;
+    fclose(file);
+    if (!ok) {
+        logMessage("Map file is truncated or corrupt; ignoring it");
+        free(bytes);
+        return 0;
+    }
+    resetWalls();
+    const unsigned char* next = bytes;
+    for (int array = 0; array < MAP_ROW_ARRAYS; ++array) {
+        WallRow* rows = mapRows(array);
+        for (int y = 0; y < mazeHeight; ++y) {
+            WallRow row = 0;
+            for (int i = 0; i < 8; ++i) {
+                row |= (WallRow)next[i] << (8 * i);
+            }
+            rows[y] |= row & rowMask;
+            next += 8;
+        }
+    }
+    free(bytes);
+    for (int index = 0; index < cellCount; ++index) {
+        refreshVisited(index);
+    }
+    restorePruned();
+#ifndef HEADLESS
+    drawKnownWalls(1);
+#endif
+    logMessage("Loaded saved maze map");
+    return 1;
+}
+
+void Floodfill_forgetUnsensed(void) {
+    if (!moduleInitialized) {
+        return;
+    }
+#ifndef HEADLESS
+    drawKnownWalls(0);
+#endif
+    for (int word = 0; word < 2 * mazeHeight; ++word) {
+        wallWords[word] &= sensedWords[word];
+        knownWords[word] &= sensedWords[word];
+    }
+    memset(visitedRows, 0, mazeHeight * sizeof(*visitedRows));
+    setBoundaryWalls();
+    for (int index = 0; index < cellCount; ++index) {
+        refreshVisited(index);
+    }
+    restorePruned();
+#ifndef HEADLESS
+    drawKnownWalls(1);
+#endif
+}
+
+void Floodfill_clearMap(void) {
+    if (!moduleInitialized) {
+        return;
+    }
+#ifndef HEADLESS
+    drawKnownWalls(0);
+#endif
+    resetWalls();
+}
+
+void Floodfill_invalidateDisplay(FloodfillCell cell) {
+    if (!moduleInitialized || !isValidCell(cell)) {
+        return;
+    }
+    shownDistances[cellIndex(cell)] = DISPLAY_UNKNOWN;
+    displayStale = 1;
+}
+
+void Floodfill_enablePruning(FloodfillCell start, const FloodfillCell* goals, int goalCount) {
+    if (!moduleInitialized || !isValidCell(start)) {
+        return;
+    }
+    pruneStartIndex = cellIndex(start);
+    pruneGoalCount = 0;
+    for (int i = 0; i < goalCount && pruneGoalCount < FLOODFILL_MAX_GOALS; ++i) {
+        if (isValidCell(goals[i])) {
+            pruneGoalIndices[pruneGoalCount++] = cellIndex(goals[i]);
+        }
+    }
+    pruningEnabled = 1;
+    restorePruned();
+}
+
+void Floodfill_setMouseCell(FloodfillCell cell) {
+    if (!moduleInitialized || !isValidCell(cell)) {
+        return;
+    }
+    int index = cellIndex(cell);
+    if (index == mouseIndex) {
+        return;
+    }
+    // The cell left behind is no longer an anchor and may be a dead end.
+    if (mouseIndex >= 0) {
+        queuePrune(mouseIndex);
+    }
+    mouseIndex = index;
+    if (isExcludedIndex(index)) {
+        logMessage("Mouse is in a pruned cell; restoring pruned cells");
+        restorePruned();
+        return;
+    }
+    drainPrune();
+}
+
+int Floodfill_isExcluded(FloodfillCell cell) {
+    if (!moduleInitialized || !isValidCell(cell)) {
+        return 0;
+    }
+    return isExcludedIndex(cellIndex(cell));
+}
+
+FloodfillProfile Floodfill_profile(void) {
+    return profile;
 }
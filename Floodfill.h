@@ -2,19 +2,147 @@
 
 #include "API.h"
 
-#define FLOODFILL_MAX_WIDTH 16
-#define FLOODFILL_MAX_HEIGHT 16
+// Largest maze Floodfill_init accepts; it refuses anything bigger rather
+// than solve part of the maze. Storage is sized to the actual maze.
+#define FLOODFILL_MAX_WIDTH 64
+#define FLOODFILL_MAX_HEIGHT 64
 #define FLOODFILL_MAX_GOALS 4
+#define FLOODFILL_MAX_FIELDS 8
+#define FLOODFILL_FIELD_NAME_SIZE 24
 
 typedef struct {
     int x;
     int y;
 } FloodfillCell;
 
-void Floodfill_init(void);
+typedef enum {
+    FLOODFILL_WALL_UNKNOWN = 0,  // not sensed yet; Floodfill_canMove treats it as open
+    FLOODFILL_WALL_OPEN,
+    FLOODFILL_WALL_PRESENT
+} FloodfillWallState;
+
+// How a flood treats walls that no visited cell has seen yet.
+typedef enum {
+    FLOODFILL_UNKNOWN_OPEN = 0,  // optimistic: unseen walls are absent
+    FLOODFILL_UNKNOWN_WALL       // pessimistic: only edges known to be open are used
+} FloodfillAssumption;
+
+// Handle to a cached distance field, or -1.
+typedef int FloodfillField;
+
+typedef struct {
+    long recalculations;  // Floodfill_recalculate calls that had goals to flood
+    long fullFloods;      // of those, how many had to reflood from scratch
+    double cpuSeconds;    // CPU time inside Floodfill_recalculate; BENCHMARK builds only
+    long adoptedFloods;   // distance updates taken from a snapshot flood or prediction instead
+} FloodfillProfile;
+
+// The walls and current goals copied out of the module, for flooding the
+// possible sensor outcomes of one cell away from the main loop.
+typedef struct FloodfillSnapshot FloodfillSnapshot;
+
+// Returns 0 if the maze is empty, too large or cannot be allocated.
+int Floodfill_init(void);
+int Floodfill_mazeWidth(void);
+int Floodfill_mazeHeight(void);
+int Floodfill_cellCount(void);
+// Recent goal sets keep their distances, so switching back to one on an
+// unchanged map floods nothing.
 void Floodfill_setGoals(const FloodfillCell* goals, int goalCount);
+// Like Floodfill_setGoals, for a short-lived target such as the next cell to
+// explore: its distances are not drawn, and each new target reuses the last
+// one's field.
+void Floodfill_setTemporaryGoals(const FloodfillCell* goals, int goalCount);
 void Floodfill_markWall(FloodfillCell cell, API_Direction direction, int present);
 void Floodfill_recalculate(void);
 int Floodfill_distanceAt(FloodfillCell cell);
 int Floodfill_canMove(FloodfillCell cell, API_Direction direction);
 FloodfillCell Floodfill_neighbor(FloodfillCell cell, API_Direction direction);
+// Walls passed to Floodfill_markWall become known. A cell is visited once
+// all four of its walls are known; marking it visited declares that they are.
+void Floodfill_markVisited(FloodfillCell cell);
+int Floodfill_isVisited(FloodfillCell cell);
+FloodfillWallState Floodfill_wallState(FloodfillCell cell, API_Direction direction);
+// Like Floodfill_canMove, but only for edges known to be open.
+int Floodfill_isKnownOpen(FloodfillCell cell, API_Direction direction);
+// Like Floodfill_isKnownOpen, but not for edges that so far only come from a
+// saved map: these may belong to another maze.
+int Floodfill_isSensedOpen(FloodfillCell cell, API_Direction direction);
+// Quarter turns (0, 1 or 2) needed to face target from heading.
+int Floodfill_rotationCost(API_Direction target, API_Direction heading);
+// Direction to leave cell toward the goals: the steepest descent, breaking
+// ties by the fewest quarter turns from heading.
+API_Direction Floodfill_bestDirection(FloodfillCell cell, API_Direction heading);
+// Before sensing in cell while facing heading, works out for each front/
+// left/right wall outcome (API_WALL_* bits) how the distances would change,
+// as a small delta over the current ones, and which direction
+// Floodfill_bestDirection would then pick. Call with distances current,
+// e.g. while the move into cell is in flight.
+void Floodfill_predictOutcomes(FloodfillCell cell, API_Direction heading);
+// Once the sensed walls are recorded, installs the delta predicted for
+// them instead of recalculating. Returns 0, changing nothing, if that
+// outcome was not predicted or other walls changed meanwhile.
+int Floodfill_commitPrediction(int walls);
+// The direction predicted for the committed outcome, while the walls and
+// goals are still the ones it was predicted for. Returns 0 otherwise.
+int Floodfill_predictedDirection(FloodfillCell cell, API_Direction heading, API_Direction* direction);
+// Floods from goals into out (one entry per cell, -1 when unreachable)
+// without touching the module's own goals or distances. Returns 0 if the
+// module is not initialised.
+int Floodfill_floodDistances(const FloodfillCell* goals,
+                             int goalCount,
+                             FloodfillAssumption assumption,
+                             int* out);
+// Named distance fields hold the flood from one goal set each and are only
+// reflooded when a wall they depend on has changed since they were last
+// read. Defining a name again with the same goals returns the same field.
+// Returns -1 if no goal is valid, the table is full, or the name is the goal
+// set Floodfill_setGoals is using and its goals would change.
+FloodfillField Floodfill_defineField(const char* name,
+                                     const FloodfillCell* goals,
+                                     int goalCount,
+                                     FloodfillAssumption assumption);
+FloodfillField Floodfill_findField(const char* name);
+// Up-to-date distances for a field (one entry per cell, -1 when
+// unreachable), or NULL for an invalid handle. The array is owned by
+// Floodfill and may change on the next call that floods.
+const int* Floodfill_fieldDistances(FloodfillField field);
+// Snapshots are sized for the maze Floodfill was initialised with; NULL if
+// allocation failed.
+FloodfillSnapshot* Floodfill_newSnapshot(void);
+void Floodfill_freeSnapshot(FloodfillSnapshot* snapshot);
+// Copies the walls and goals for sensing in cell with the mouse facing
+// heading. Returns 0 if the cell is off the maze or no goals are set.
+int Floodfill_takeSnapshot(FloodfillSnapshot* snapshot, FloodfillCell cell, API_Direction heading);
+// Floods the snapshot's goals into out (one entry per cell) as if walls
+// (API_WALL_* bits) were sensed in its cell. Touches only the snapshot and
+// out, so it may run on another thread while the module is in use.
+void Floodfill_floodSnapshot(FloodfillSnapshot* snapshot, int walls, int* out);
+// Takes distances flooded for walls as the current ones, instead of
+// recalculating, when the module's walls and goals are exactly the
+// snapshot's with that outcome applied. Returns 0 and changes nothing
+// otherwise.
+int Floodfill_adoptSnapshotFlood(FloodfillSnapshot* snapshot, int walls, const int* flooded);
+// Writes the known walls to a compact binary file. Returns 0 on I/O errors.
+int Floodfill_saveMap(const char* path);
+// Replaces the walls with those saved by Floodfill_saveMap. Returns 0 and
+// leaves the walls alone if the file is missing, corrupt or for another
+// maze size.
+int Floodfill_loadMap(const char* path);
+// Forgets the walls that so far only come from a saved map, keeping those
+// sensed or driven through since.
+void Floodfill_forgetUnsensed(void);
+// Forgets every wall learned so far.
+void Floodfill_clearMap(void);
+// Forces the next recalculation to redraw this cell's distance, for when
+// something else (e.g. position tracking) has written text over it.
+void Floodfill_invalidateDisplay(FloodfillCell cell);
+// Prunes cells no path between the start, these centre goals, the mouse and
+// the current goals can use: dead ends (unknown edges count as open) and
+// regions cut off from the mouse. Pruned cells read -1 in every field and
+// are not flooded. Removing a wall next to one restores them all.
+void Floodfill_enablePruning(FloodfillCell start, const FloodfillCell* goals, int goalCount);
+// Tells pruning where the mouse is; call before marking its walls.
+void Floodfill_setMouseCell(FloodfillCell cell);
+int Floodfill_isExcluded(FloodfillCell cell);
+FloodfillProfile Floodfill_profile(void);
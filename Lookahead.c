@@ -0,0 +1,184 @@
+#include "Lookahead.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+
+#ifdef LOOKAHEAD_THREAD
+#include <pthread.h>
+
+#define OUTCOME_COUNT 8
+
+// Outcomes by rough likelihood: corridors, then dead ends, then junctions.
+static const int OUTCOME_ORDER[OUTCOME_COUNT] = {
+    API_WALL_LEFT | API_WALL_RIGHT,
+    API_WALL_FRONT | API_WALL_RIGHT,
+    API_WALL_FRONT | API_WALL_LEFT,
+    API_WALL_FRONT | API_WALL_LEFT | API_WALL_RIGHT,
+    API_WALL_RIGHT,
+    API_WALL_LEFT,
+    API_WALL_FRONT,
+    0,
+};
+
+// The snapshot and outcome arrays belong to the worker while it is busy and
+// to the main thread otherwise; everything else is guarded by lock.
+static FloodfillSnapshot* snapshot = NULL;
+static int* outcomeDistances = NULL;
+static int outcomeReady[OUTCOME_COUNT];
+// Sensor bits already settled by known walls, and their values; outcomes
+// that disagree cannot happen and are not flooded.
+static int knownMask = 0;
+static int knownBits = 0;
+static int cellCount = 0;
+static int jobPending = 0;
+static int jobActive = 0;
+static int workerBusy = 0;
+static int cancelRequested = 0;
+static pthread_t worker;
+static pthread_mutex_t lock = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t wake = PTHREAD_COND_INITIALIZER;
+static pthread_cond_t idle = PTHREAD_COND_INITIALIZER;
+
+static void logMessage(const char* text) {
+#ifndef HEADLESS
+    fprintf(stderr, "%s\n", text);
+    fflush(stderr);
+#else
+    (void)text;
+#endif
+}
+
+static void* runWorker(void* unused) {
+    (void)unused;
+    pthread_mutex_lock(&lock);
+    while (1) {
+        while (!jobPending) {
+            pthread_cond_wait(&wake, &lock);
+        }
+        jobPending = 0;
+        workerBusy = 1;
+        for (int i = 0; i < OUTCOME_COUNT && !cancelRequested; ++i) {
+            int walls = OUTCOME_ORDER[i];
+            if ((walls & knownMask) != knownBits) {
+                continue;
+            }
+            pthread_mutex_unlock(&lock);
+            Floodfill_floodSnapshot(snapshot, walls, outcomeDistances + (size_t)walls * cellCount);
+            pthread_mutex_lock(&lock);
+            outcomeReady[walls] = 1;
+        }
+        workerBusy = 0;
+        pthread_cond_signal(&idle);
+    }
+    return NULL;
+}
+
+// Waits until the worker has let go of the snapshot, abandoning any
+// outcomes it has not started.
+static void stopWorker(void) {
+    pthread_mutex_lock(&lock);
+    cancelRequested = 1;
+    jobPending = 0;
+    while (workerBusy) {
+        pthread_cond_wait(&idle, &lock);
+    }
+    cancelRequested = 0;
+    pthread_mutex_unlock(&lock);
+}
+
+// Records which of the front, left and right walls of cell are known.
+static void settleKnownWalls(FloodfillCell cell, API_Direction heading) {
+    const API_Direction directions[3] = {
+        heading,
+        (API_Direction)((heading + 3) % 4),
+        (API_Direction)((heading + 1) % 4),
+    };
+    const int bits[3] = {API_WALL_FRONT, API_WALL_LEFT, API_WALL_RIGHT};
+    knownMask = 0;
+    knownBits = 0;
+    for (int i = 0; i < 3; ++i) {
+        FloodfillWallState state = Floodfill_wallState(cell, directions[i]);
+        if (state != FLOODFILL_WALL_UNKNOWN) {
+            knownMask |= bits[i];
+            knownBits |= (state == FLOODFILL_WALL_PRESENT) ? bits[i] : 0;
+        }
+    }
+}
+#endif
+
+int Lookahead_init(void) {
+#ifdef LOOKAHEAD_THREAD
+    if (snapshot != NULL) {
+        logMessage("Lookahead_init called twice");
+        return 0;
+    }
+    cellCount = Floodfill_cellCount();
+    if (cellCount <= 0) {
+        logMessage("Lookahead_init called before Floodfill_init");
+        return 0;
+    }
+    snapshot = Floodfill_newSnapshot();
+    outcomeDistances = malloc((size_t)OUTCOME_COUNT * cellCount * sizeof(*outcomeDistances));
+    if (snapshot == NULL || outcomeDistances == NULL) {
+        logMessage("Lookahead storage allocation failed");
+        Floodfill_freeSnapshot(snapshot);
+        free(outcomeDistances);
+        snapshot = NULL;
+        outcomeDistances = NULL;
+        return 0;
+    }
+    if (pthread_create(&worker, NULL, runWorker, NULL) != 0) {
+        logMessage("Unable to start the lookahead thread; running without it");
+        Floodfill_freeSnapshot(snapshot);
+        free(outcomeDistances);
+        snapshot = NULL;
+        outcomeDistances = NULL;
+        return 1;
+    }
+    pthread_detach(worker);
+    logMessage("Lookahead thread started");
+#endif
+    return 1;
+}
+
+void Lookahead_begin(FloodfillCell cell, API_Direction heading) {
+#ifdef LOOKAHEAD_THREAD
+    if (snapshot == NULL) {
+        return;
+    }
+    stopWorker();
+    jobActive = Floodfill_takeSnapshot(snapshot, cell, heading);
+    if (!jobActive) {
+        return;
+    }
+    pthread_mutex_lock(&lock);
+    settleKnownWalls(cell, heading);
+    for (int i = 0; i < OUTCOME_COUNT; ++i) {
+        outcomeReady[i] = 0;
+    }
+    jobPending = 1;
+    pthread_cond_signal(&wake);
+    pthread_mutex_unlock(&lock);
+#else
+    (void)cell;
+    (void)heading;
+#endif
+}
+
+int Lookahead_adopt(int walls) {
+#ifdef LOOKAHEAD_THREAD
+    if (!jobActive) {
+        return 0;
+    }
+    stopWorker();
+    jobActive = 0;
+    int outcome = walls & (API_WALL_FRONT | API_WALL_LEFT | API_WALL_RIGHT);
+    if (!outcomeReady[outcome]) {
+        return 0;
+    }
+    return Floodfill_adoptSnapshotFlood(snapshot, outcome, outcomeDistances + (size_t)outcome * cellCount);
+#else
+    (void)walls;
+    return 0;
+#endif
+}
@@ -0,0 +1,23 @@
+#pragma once
+
+#include "Floodfill.h"
+
+// Speculative flooding while a move is in flight. Before the mouse enters a
+// cell, a worker thread floods the current goals for each wall outcome the
+// cell could report, so once the sensors answer the distances are usually
+// ready and the main loop skips its own recalculation.
+//
+// Build with -DLOOKAHEAD_THREAD -pthread to enable it; otherwise every call
+// is a no-op and Lookahead_adopt always returns 0.
+
+// Sizes the outcome storage and starts the worker. Call after
+// Floodfill_init; returns 0 if allocation failed. If the thread cannot be
+// started the lookahead is just left off.
+int Lookahead_init(void);
+// Starts flooding the outcomes of sensing in cell while facing heading.
+// Call just before the move that enters it.
+void Lookahead_begin(FloodfillCell cell, API_Direction heading);
+// Stops the worker and, if it flooded the sensed outcome and the walls
+// match it, installs those distances in Floodfill. Returns 1 when Floodfill
+// is up to date and needs no recalculation.
+int Lookahead_adopt(int walls);
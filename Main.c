@@ -1,29 +1,89 @@
 #include <limits.h>
 #include <stdio.h>
+#include <stdlib.h>
 
 #include "API.h"
+#include "Explore.h"
 #include "Floodfill.h"
+#include "Lookahead.h"
+#include "Motion.h"
+#include "Planner.h"
+#include "Stats.h"
 
-#define MAX_PATH_LENGTH (FLOODFILL_MAX_WIDTH * FLOODFILL_MAX_HEIGHT)
-
-typedef enum {
-    PHASE_TO_CENTER = 0,
-    PHASE_TO_START,
-    PHASE_DONE
-} NavigationPhase;
-
-static NavigationPhase navigationPhase = PHASE_TO_CENTER;
 static FloodfillCell centerGoals[FLOODFILL_MAX_GOALS];
 static int centerGoalCount = 0;
-static FloodfillCell currentGoals[FLOODFILL_MAX_GOALS];
-static int currentGoalCount = 0;
 static const FloodfillCell START_GOAL = {0, 0};
-static API_Direction fastPath[MAX_PATH_LENGTH];
+#define WALLS_NOT_SENSED -1
+
+// Scored start-to-centre runs per session; $MMS_FAST_RUNS overrides it.
+#ifndef FAST_RUN_COUNT
+#define FAST_RUN_COUNT 1
+#endif
+
+// Blocked steps in a row, each turning to face a wall the mouse could not
+// drive through, before the search gives up. A cell has four sides, so more
+// than that means the tracked pose no longer matches the maze.
+#ifndef SEARCH_STALL_LIMIT
+#define SEARCH_STALL_LIMIT 4
+#endif
+
+typedef enum {
+    SEARCH_DONE = 0,
+    SEARCH_RESET,    // the simulator was reset part way
+    SEARCH_STALLED   // no move got through SEARCH_STALL_LIMIT times running
+} SearchResult;
+
+// How a drive along a planned route ended.
+typedef enum {
+    DRIVE_DONE = 0,
+    DRIVE_NO_PLAN,  // no route over known passages; nothing was sent
+    DRIVE_CRASHED
+} DriveResult;
+
+typedef enum {
+    RUN_SEARCH = 0,  // exploring until the strategy is satisfied
+    RUN_FAST,        // start to centre on the fastest known plan
+    RUN_RETURN,      // centre back to start for the next fast run
+    RUN_RECOVER,     // acknowledge a reset and carry on from the start
+    RUN_DONE
+} RunPhase;
+
+// Session state that outlives a simulator reset: the maze knowledge lives
+// in Floodfill, and the fast plan stays valid until the walls are relearned.
+static ExploreStrategy exploreStrategy = EXPLORE_DEFAULT_STRATEGY;
+static const char* mapPath = NULL;
+static int searchComplete = 0;
+static int searchedThisSession = 0;
+static int fastPlanValid = 0;
+static API_Direction fastPlanHeading = API_DIR_NORTH;
+static int fastRunsWanted = FAST_RUN_COUNT;
+static int fastRunsDone = 0;
+static int relearnedMaze = 0;
+static int pendingWalls = WALLS_NOT_SENSED;
+
+// Where the learned walls are kept between runs; $MMS_MAP_FILE overrides it
+// and an empty value turns persistence off.
+#ifndef MAP_FILE_DEFAULT
+#define MAP_FILE_DEFAULT "maze.map"
+#endif
+// Path buffers hold one entry per maze cell and are allocated at startup.
+static int maxPathLength = 0;
+static API_Direction* fastPath = NULL;
 static int fastPathLength = 0;
+static PlannerMove* fastMoves = NULL;
+static int fastMoveCount = 0;
+static PlannerMove* returnMoves = NULL;
+static int cellsExplored = 0;
+static int searchSteps = 0;
+static int fastRunCells = 0;
 
 static void debugLog(const char* text) {
+#ifndef HEADLESS
     fprintf(stderr, "%s\n", text);
     fflush(stderr);
+#else
+    (void)text;
+#endif
 }
 
 static API_Direction rotateLeft(API_Direction direction) {
@@ -55,23 +115,9 @@ static int isCenterCell(FloodfillCell cell) {
     return isCellInList(cell, centerGoals, centerGoalCount);
 }
 
-static void applyGoals(const FloodfillCell* goals, int count) {
-    if (count < 0) {
-        count = 0;
-    }
-    if (count > FLOODFILL_MAX_GOALS) {
-        count = FLOODFILL_MAX_GOALS;
-    }
-    currentGoalCount = count;
-    for (int i = 0; i < currentGoalCount; ++i) {
-        currentGoals[i] = goals[i];
-    }
-    Floodfill_setGoals(goals, currentGoalCount);
-}
-
 static void computeCenterGoals(void) {
-    int width = API_mazeWidth();
-    int height = API_mazeHeight();
+    int width = Floodfill_mazeWidth();
+    int height = Floodfill_mazeHeight();
 
     centerGoalCount = 0;
     int xLow = (width - 1) / 2;
@@ -91,101 +137,39 @@ static void computeCenterGoals(void) {
     }
 }
 
-static void updateNavigationPhase(FloodfillCell current) {
-    if (navigationPhase == PHASE_TO_CENTER) {
-        if (isCenterCell(current)) {
-            debugLog("Reached center; targeting start");
-            applyGoals(&START_GOAL, 1);
-            navigationPhase = PHASE_TO_START;
+// Records the walls sensed in the current cell, then refreshes distances.
+// WALLS_NOT_SENSED means the cell was already fully known. The wall behind
+// is normally the passage the mouse came in by; only when that is known
+// does the cell count as visited.
+static void applyWallsAndFlood(int walls) {
+    FloodfillCell current = {API_mouseX(), API_mouseY()};
+    Floodfill_setMouseCell(current);
+    if (walls != WALLS_NOT_SENSED) {
+        API_Direction heading = API_mouseHeading();
+        if (!Floodfill_isVisited(current)) {
+            cellsExplored += 1;
         }
-        return;
-    }
-
-    if (navigationPhase == PHASE_TO_START) {
-        if (cellsEqual(current, START_GOAL)) {
-            debugLog("Returned to start; run complete");
-            navigationPhase = PHASE_DONE;
+        Floodfill_markWall(current, heading, (walls & API_WALL_FRONT) ? 1 : 0);
+        Floodfill_markWall(current, rotateLeft(heading), (walls & API_WALL_LEFT) ? 1 : 0);
+        Floodfill_markWall(current, rotateRight(heading), (walls & API_WALL_RIGHT) ? 1 : 0);
+        if (Floodfill_wallState(current, rotateBack(heading)) != FLOODFILL_WALL_UNKNOWN) {
+            Floodfill_markVisited(current);
         }
-    }
-}
-
-static int rotationCost(API_Direction target, API_Direction heading) {
-    int diff = (target - heading + 4) % 4;
-    if (diff == 0) {
-        return 0;
-    }
-    if (diff == 1 || diff == 3) {
-        return 1;
-    }
-    return 2;
-}
-
-static void rotateTo(API_Direction target) {
-    API_Direction heading = API_mouseHeading();
-    while (heading != target) {
-        int diff = (target - heading + 4) % 4;
-        if (diff == 1) {
-            API_turnRight();
-        } else if (diff == 3) {
-            API_turnLeft();
-        } else {
-            API_turnLeft();
-            API_turnLeft();
+        if (Floodfill_commitPrediction(walls) || Lookahead_adopt(walls)) {
+            return;
         }
-        heading = API_mouseHeading();
     }
-}
-
-static void senseWallsAndFlood(void) {
-    FloodfillCell current = {API_mouseX(), API_mouseY()};
-    API_Direction heading = API_mouseHeading();
-
-    Floodfill_markWall(current, heading, API_wallFront() ? 1 : 0);
-    Floodfill_markWall(current, rotateLeft(heading), API_wallLeft() ? 1 : 0);
-    Floodfill_markWall(current, rotateRight(heading), API_wallRight() ? 1 : 0);
-
     Floodfill_recalculate();
 }
 
+// A prediction made while the move was in flight answers without looking
+// at the distances again.
 static API_Direction chooseNextDirection(FloodfillCell current, API_Direction heading) {
-    int currentDistance = Floodfill_distanceAt(current);
-    int bestDistance = INT_MAX;
-    int bestRotation = INT_MAX;
-    API_Direction bestDirection = heading;
-    int foundBetter = 0;
-
-    for (API_Direction dir = API_DIR_NORTH; dir <= API_DIR_WEST; dir = (API_Direction)(dir + 1)) {
-        if (!Floodfill_canMove(current, dir)) {
-            continue;
-        }
-        FloodfillCell neighbor = Floodfill_neighbor(current, dir);
-        int neighborDistance = Floodfill_distanceAt(neighbor);
-        if (neighborDistance < 0) {
-            continue;
-        }
-        int rotCost = rotationCost(dir, heading);
-        if (currentDistance >= 0 && neighborDistance < currentDistance) {
-            if (!foundBetter || neighborDistance < bestDistance ||
-                (neighborDistance == bestDistance && rotCost < bestRotation)) {
-                foundBetter = 1;
-                bestDistance = neighborDistance;
-                bestRotation = rotCost;
-                bestDirection = dir;
-            }
-            continue;
-        }
-        if (foundBetter) {
-            continue;
-        }
-        if (neighborDistance < bestDistance ||
-            (neighborDistance == bestDistance && rotCost < bestRotation)) {
-            bestDistance = neighborDistance;
-            bestRotation = rotCost;
-            bestDirection = dir;
-        }
+    API_Direction predicted;
+    if (Floodfill_predictedDirection(current, heading, &predicted)) {
+        return predicted;
     }
-
-    return bestDirection;
+    return Floodfill_bestDirection(current, heading);
 }
 
 static int buildFastPath(void) {
@@ -194,14 +178,14 @@ static int buildFastPath(void) {
         return 0;
     }
 
-    applyGoals(centerGoals, centerGoalCount);
+    Floodfill_setGoals(centerGoals, centerGoalCount);
     Floodfill_recalculate();
 
     FloodfillCell current = START_GOAL;
     API_Direction heading = API_mouseHeading();
     fastPathLength = 0;
 
-    int safety = MAX_PATH_LENGTH;
+    int safety = maxPathLength;
     while (!isCenterCell(current)) {
         if (safety-- <= 0) {
             debugLog("Fast path build aborted: exceeded length limit");
@@ -228,7 +212,7 @@ static int buildFastPath(void) {
             if (neighborDistance < 0 || neighborDistance >= currentDistance) {
                 continue;
             }
-            int rot = rotationCost(dir, heading);
+            int rot = Floodfill_rotationCost(dir, heading);
             if (!found || rot < bestRotation) {
                 bestRotation = rot;
                 chosenDir = dir;
@@ -241,7 +225,7 @@ static int buildFastPath(void) {
             return 0;
         }
 
-        if (fastPathLength >= MAX_PATH_LENGTH) {
+        if (fastPathLength >= maxPathLength) {
             debugLog("Fast path build failed: path buffer overflow");
             return 0;
         }
@@ -253,62 +237,365 @@ static int buildFastPath(void) {
     return 1;
 }
 
-static void executeFastRun(void) {
+// Collapses consecutive cells with the same heading into straightaways.
+static void compressFastPath(void) {
+    fastMoveCount = 0;
+    for (int i = 0; i < fastPathLength; ++i) {
+        if (fastMoveCount > 0 && fastMoves[fastMoveCount - 1].heading == fastPath[i]) {
+            fastMoves[fastMoveCount - 1].length += 1;
+            continue;
+        }
+        fastMoves[fastMoveCount++] = (PlannerMove){PLANNER_STRAIGHT, fastPath[i], fastPath[i], 1};
+    }
+}
+
+static int planFastRun(void) {
+    if (fastPlanValid && fastPlanHeading == API_mouseHeading()) {
+        return 1;
+    }
+    fastPlanValid = 0;
+    fastPlanHeading = API_mouseHeading();
+    PlannerWeights weights = Planner_defaultWeights();
+    fastMoveCount = Planner_plan(START_GOAL, API_mouseHeading(), centerGoals, centerGoalCount,
+                                 &weights, fastMoves, maxPathLength);
+    if (fastMoveCount < 0) {
+        debugLog("Weighted planner failed; falling back to floodfill descent");
+        if (!buildFastPath()) {
+            return 0;
+        }
+        compressFastPath();
+    }
+    fastPlanValid = 1;
+    return 1;
+}
+
+static DriveResult executeFastRun(void) {
     debugLog("Starting fast run toward center");
-    if (!buildFastPath()) {
+    if (!planFastRun()) {
         debugLog("Fast run aborted: unable to build path");
-        return;
+        return DRIVE_NO_PLAN;
     }
 
+#ifndef HEADLESS
     char logBuffer[64];
-    snprintf(logBuffer, sizeof(logBuffer), "Fast path length: %d", fastPathLength);
+    snprintf(logBuffer, sizeof(logBuffer), "Fast path moves: %d", fastMoveCount);
     debugLog(logBuffer);
+#endif
 
-    for (int i = 0; i < fastPathLength; ++i) {
-        API_Direction stepDir = fastPath[i];
-        rotateTo(stepDir);
-        if (!API_moveForward()) {
-            debugLog("Fast run halted: move failed");
-            return;
-        }
+    if (!Motion_drive(fastMoves, fastMoveCount)) {
+        debugLog("Fast run halted: move failed");
+        return DRIVE_CRASHED;
+    }
+    for (int i = 0; i < fastMoveCount; ++i) {
+        fastRunCells += fastMoves[i].length;
     }
 
     debugLog("Fast run complete");
+    return DRIVE_DONE;
 }
 
-int main(int argc, char* argv[]) {
-    debugLog("Running...");
-    API_setColor(0, 0, 'G');
-    API_initMouseTracking();
-    Floodfill_init();
-    computeCenterGoals();
-    applyGoals(centerGoals, centerGoalCount);
-    navigationPhase = PHASE_TO_CENTER;
+// Drives back to the start over known passages.
+static DriveResult returnToStart(void) {
+    FloodfillCell current = {API_mouseX(), API_mouseY()};
+    PlannerWeights weights = Planner_defaultWeights();
+    int count = Planner_plan(current, API_mouseHeading(), &START_GOAL, 1, &weights, returnMoves, maxPathLength);
+    if (count < 0) {
+        debugLog("Return aborted: no known path to start");
+        return DRIVE_NO_PLAN;
+    }
+    if (!Motion_drive(returnMoves, count)) {
+        debugLog("Return halted: move failed");
+        return DRIVE_CRASHED;
+    }
+    return DRIVE_DONE;
+}
+
+static int fastRunTarget(void) {
+    const char* text = getenv("MMS_FAST_RUNS");
+    int count = (text != NULL) ? atoi(text) : FAST_RUN_COUNT;
+    return count > 0 ? count : 1;
+}
+
+static const char* mapFilePath(void) {
+    const char* path = getenv("MMS_MAP_FILE");
+    if (path == NULL) {
+        return MAP_FILE_DEFAULT;
+    }
+    return path[0] != '\0' ? path : NULL;
+}
+
+// A saved map is only trusted if it agrees with what the mouse can see from
+// the start cell.
+static int matchesKnownWalls(FloodfillCell cell, API_Direction heading, int walls) {
+    const API_Direction directions[3] = {heading, rotateLeft(heading), rotateRight(heading)};
+    const int bits[3] = {API_WALL_FRONT, API_WALL_LEFT, API_WALL_RIGHT};
+    for (int i = 0; i < 3; ++i) {
+        FloodfillWallState state = Floodfill_wallState(cell, directions[i]);
+        if (state != FLOODFILL_WALL_UNKNOWN && (state == FLOODFILL_WALL_PRESENT) != ((walls & bits[i]) != 0)) {
+            return 0;
+        }
+    }
+    return 1;
+}
+
+static int allocatePathStorage(void) {
+    maxPathLength = Floodfill_cellCount();
+    if (maxPathLength <= 0) {
+        return 0;
+    }
+    fastPath = malloc((size_t)maxPathLength * sizeof(*fastPath));
+    fastMoves = malloc((size_t)maxPathLength * sizeof(*fastMoves));
+    returnMoves = malloc((size_t)maxPathLength * sizeof(*returnMoves));
+    return fastPath != NULL && fastMoves != NULL && returnMoves != NULL;
+}
+
+#ifdef BENCHMARK
+// Writes run counters as key=value lines to $MMS_STATS_FILE, or stderr.
+static void reportBenchmark(void) {
+    const char* path = getenv("MMS_STATS_FILE");
+    FILE* out = (path != NULL && path[0] != '\0') ? fopen(path, "w") : stderr;
+    if (out == NULL) {
+        return;
+    }
+    FloodfillProfile profile = Floodfill_profile();
+    fprintf(out, "cells_explored=%d\n", cellsExplored);
+    fprintf(out, "search_steps=%d\n", searchSteps);
+    fprintf(out, "fast_path_length=%d\n", fastRunCells);
+    fprintf(out, "recalculations=%ld\n", profile.recalculations);
+    fprintf(out, "full_floods=%ld\n", profile.fullFloods);
+    fprintf(out, "recalc_cpu_us=%.0f\n", profile.cpuSeconds * 1e6);
+    fprintf(out, "adopted_floods=%ld\n", profile.adoptedFloods);
+    if (out != stderr) {
+        fclose(out);
+    }
+}
+#endif
+
+// Explores until the strategy is done, starting from walls sensed in the
+// current cell. After a reset the walls sensed with it are from the start
+// cell, so they are dropped.
+static SearchResult searchRun(int walls) {
+    int stalls = 0;
     while (1) {
-        senseWallsAndFlood();
+        if (walls != WALLS_NOT_SENSED && (walls & API_WALL_RESET)) {
+            debugLog("Simulator was reset during search");
+            return SEARCH_RESET;
+        }
+        if (stalls > SEARCH_STALL_LIMIT) {
+            debugLog("Search is not getting anywhere; stopping");
+            return SEARCH_STALLED;
+        }
+        applyWallsAndFlood(walls);
         FloodfillCell current = {API_mouseX(), API_mouseY()};
-        updateNavigationPhase(current);
-        if (navigationPhase == PHASE_DONE) {
+        if (!Explore_update(current)) {
             break;
         }
         API_Direction heading = API_mouseHeading();
 
         API_Direction targetDirection = chooseNextDirection(current, heading);
-        rotateTo(targetDirection);
 
         if (!Floodfill_canMove(current, targetDirection)) {
             Floodfill_markWall(current, targetDirection, 1);
+            Motion_face(targetDirection);
+            walls = API_senseWalls();
+            stalls += 1;
+            continue;
+        }
+
+        // Only after relearning from where a fast run crashed can the way out
+        // be a wall nobody has looked at; look before driving into it.
+        if (Floodfill_wallState(current, targetDirection) == FLOODFILL_WALL_UNKNOWN) {
+            Motion_face(targetDirection);
+            walls = API_senseWalls();
+            stalls += 1;
             continue;
         }
 
-        if (!API_moveForward()) {
+        // Any turn goes out with the move. Cells whose walls are all known
+        // are entered without sensing. On a crash any walls sensed belong to
+        // the cell we never left.
+        int moved;
+        if (Floodfill_isVisited(Floodfill_neighbor(current, targetDirection))) {
+            walls = WALLS_NOT_SENSED;
+            moved = Motion_straight(targetDirection, 1);
+        } else {
+            FloodfillCell next = Floodfill_neighbor(current, targetDirection);
+            Lookahead_begin(next, targetDirection);
+            Motion_sendStepAndSense(targetDirection);
+            Floodfill_predictOutcomes(next, targetDirection);
+            moved = Motion_receiveStepAndSense(&walls);
+        }
+        if (!moved) {
             Floodfill_markWall(current, targetDirection, 1);
+            stalls += 1;
             continue;
         }
 
+        stalls = 0;
+        searchSteps += 1;
         FloodfillCell updated = {API_mouseX(), API_mouseY()};
+        Floodfill_invalidateDisplay(updated);
         Floodfill_markWall(updated, rotateBack(API_mouseHeading()), 0);
     }
     debugLog("Navigation loop exited");
-    executeFastRun();
+    return SEARCH_DONE;
+}
+
+static RunPhase beginSearch(void) {
+    searchComplete = 0;
+    fastPlanValid = 0;
+    Explore_begin(exploreStrategy, START_GOAL, centerGoals, centerGoalCount);
+    pendingWalls = API_senseWalls();
+    return RUN_SEARCH;
+}
+
+static RunPhase runSearch(void) {
+    Stats_beginSection("search");
+    SearchResult result = searchRun(pendingWalls);
+    if (result == SEARCH_RESET) {
+        return RUN_RECOVER;
+    }
+    if (result == SEARCH_STALLED) {
+        return RUN_DONE;
+    }
+    searchComplete = 1;
+    searchedThisSession = 1;
+    fastPlanValid = 0;
+    if (mapPath != NULL) {
+        Floodfill_saveMap(mapPath);
+    }
+    return RUN_FAST;
+}
+
+// A move failed on walls we believed. Either the simulator was reset under
+// us, or the walls came from another maze and are relearned once. Saved-map
+// passages are driven a cell at a time, so the crash left the mouse in a
+// known cell: the search restarts there with only the sensed walls. A crash
+// part way through a longer move leaves it anywhere, and only a reset can
+// put it somewhere known again.
+static RunPhase recoverFromCrash(void) {
+    if (API_wasReset()) {
+        return RUN_RECOVER;
+    }
+    if (API_poseLost()) {
+        debugLog("Lost track of the mouse after a crash; stopping");
+        return RUN_DONE;
+    }
+    if (relearnedMaze) {
+        debugLog("Known walls still disagree with the maze; stopping");
+        return RUN_DONE;
+    }
+    relearnedMaze = 1;
+    debugLog("Known walls disagree with this maze; relearning it");
+    Floodfill_forgetUnsensed();
+    return beginSearch();
+}
+
+// The known walls hold no route, so nothing was driven and they are kept.
+// If they all came from a saved map that let the search be skipped, search
+// now; a search this session already found what there is to find.
+static RunPhase recoverFromNoPlan(void) {
+    if (searchedThisSession) {
+        debugLog("No route over known walls; stopping");
+        return RUN_DONE;
+    }
+    debugLog("No route over the saved walls; searching");
+    return beginSearch();
+}
+
+// A reset only moves the mouse once it is acknowledged, so the run goes
+// ahead without asking first; recoverFromCrash asks if a move fails, and
+// the search sees it with every wall sense.
+static RunPhase runFast(void) {
+    char label[24];
+    snprintf(label, sizeof(label), "fast %d", fastRunsDone + 1);
+    Stats_beginSection(label);
+    DriveResult result = executeFastRun();
+    if (result == DRIVE_NO_PLAN) {
+        return recoverFromNoPlan();
+    }
+    if (result == DRIVE_CRASHED) {
+        return recoverFromCrash();
+    }
+    fastRunsDone += 1;
+    return (fastRunsDone < fastRunsWanted) ? RUN_RETURN : RUN_DONE;
+}
+
+static RunPhase runReturn(void) {
+    Stats_beginSection("return");
+    DriveResult result = returnToStart();
+    if (result == DRIVE_NO_PLAN) {
+        return recoverFromNoPlan();
+    }
+    if (result == DRIVE_CRASHED) {
+        return recoverFromCrash();
+    }
+    return RUN_FAST;
+}
+
+// The simulator has put the mouse back at the start facing north. Walls and
+// the fast plan survive; an unfinished search resumes from there.
+static RunPhase runRecover(void) {
+    Stats_beginSection("recover");
+    API_ackReset();
+    if (searchComplete) {
+        return RUN_FAST;
+    }
+    return beginSearch();
+}
+
+int main(int argc, char* argv[]) {
+    Stats_reportAtExit();
+    Stats_beginSection("startup");
+    debugLog("Running...");
+#ifndef HEADLESS
+    API_setColor(0, 0, 'G');
+#endif
+    API_initMouseTracking();
+    if (!Floodfill_init()) {
+        return 1;
+    }
+    if (!allocatePathStorage() || !Planner_init() || !Explore_init() || !Lookahead_init()) {
+        debugLog("Unable to allocate maze storage");
+        return 1;
+    }
+    computeCenterGoals();
+    Floodfill_enablePruning(START_GOAL, centerGoals, centerGoalCount);
+    // The strategy may be named as the first argument, e.g. "center-and-back".
+    exploreStrategy = Explore_strategyNamed(argc > 1 ? argv[1] : NULL, EXPLORE_DEFAULT_STRATEGY);
+    debugLog(Explore_strategyName(exploreStrategy));
+    fastRunsWanted = fastRunTarget();
+    mapPath = mapFilePath();
+    int mapLoaded = mapPath != NULL && Floodfill_loadMap(mapPath);
+    RunPhase phase = beginSearch();
+    if (mapLoaded && !matchesKnownWalls(START_GOAL, API_mouseHeading(), pendingWalls)) {
+        debugLog("Saved map does not match this maze; discarding it");
+        Floodfill_clearMap();
+    } else if (mapLoaded && Explore_isShortestPathProven()) {
+        debugLog("Saved map already proves the shortest path; skipping search");
+        applyWallsAndFlood(pendingWalls);
+        searchComplete = 1;
+        phase = RUN_FAST;
+    }
+    while (phase != RUN_DONE) {
+        switch (phase) {
+            case RUN_SEARCH:
+                phase = runSearch();
+                break;
+            case RUN_FAST:
+                phase = runFast();
+                break;
+            case RUN_RETURN:
+                phase = runReturn();
+                break;
+            case RUN_RECOVER:
+                phase = runRecover();
+                break;
+            case RUN_DONE:
+                break;
+        }
+    }
+#ifdef BENCHMARK
+    reportBenchmark();
+#endif
 }
@@ -0,0 +1,193 @@
+#include "Motion.h"
+
+#include "Floodfill.h"
+
+// Shortest zig-zag driven as a 45 degree run. It takes at most five
+// commands however long it is, against one per cell and per turn driven
+// cell by cell, so shorter ones are left as they are.
+#ifndef MOTION_DIAGONAL_MIN_CELLS
+#define MOTION_DIAGONAL_MIN_CELLS 4
+#endif
+
+// A stretch of half cells along one of the eight headings (0 = north,
+// clockwise in eighths of a turn).
+typedef struct {
+    int heading8;
+    int halfSteps;
+} Leg;
+
+// Where the queued motions leave the mouse. Tracking in API.c only catches
+// up once they are answered.
+static int plannedHeading8 = 0;
+static int plannedAtCentre = 1;
+static FloodfillCell plannedCell = {0, 0};
+static Leg pendingLeg = {0, 0};
+
+// Turns by the shortest way round (a U-turn is two left turns): quarter
+// turns first, then a 45 degree turn for an odd remainder.
+static void queueTurn(int eighths) {
+    eighths = ((eighths % 8) + 8) % 8;
+    if (eighths >= 4) {
+        eighths -= 8;
+    }
+    while (eighths >= 2) {
+        API_queueTurnRight();
+        eighths -= 2;
+    }
+    while (eighths <= -2) {
+        API_queueTurnLeft();
+        eighths += 2;
+    }
+    if (eighths == 1) {
+        API_queueTurnRight45();
+    } else if (eighths == -1) {
+        API_queueTurnLeft45();
+    }
+}
+
+static void beginPlan(void) {
+    plannedHeading8 = 2 * API_mouseHeading();
+    plannedAtCentre = 1;
+    plannedCell = (FloodfillCell){API_mouseX(), API_mouseY()};
+    pendingLeg.halfSteps = 0;
+}
+
+// Whole cells when the leg starts and ends on cell centres, half steps
+// otherwise.
+static void flushLeg(void) {
+    if (pendingLeg.halfSteps == 0) {
+        return;
+    }
+    queueTurn(pendingLeg.heading8 - plannedHeading8);
+    plannedHeading8 = pendingLeg.heading8;
+    int orthogonal = plannedHeading8 % 2 == 0;
+    if (plannedAtCentre && orthogonal && pendingLeg.halfSteps % 2 == 0) {
+        API_queueMoveForward(pendingLeg.halfSteps / 2);
+    } else {
+        API_queueMoveForwardHalf(pendingLeg.halfSteps);
+    }
+    if (orthogonal && pendingLeg.halfSteps % 2 == 1) {
+        plannedAtCentre = !plannedAtCentre;
+    }
+    pendingLeg.halfSteps = 0;
+}
+
+static void addLeg(int heading8, int halfSteps) {
+    if (halfSteps <= 0) {
+        return;
+    }
+    if (pendingLeg.halfSteps > 0 && pendingLeg.heading8 == heading8) {
+        pendingLeg.halfSteps += halfSteps;
+        return;
+    }
+    flushLeg();
+    pendingLeg = (Leg){heading8, halfSteps};
+}
+
+// Heading of the i-th cell of a move: a zig-zag alternates between its two.
+static API_Direction cellHeading(const PlannerMove* move, int i) {
+    if (move->kind == PLANNER_DIAGONAL && i % 2 == 1) {
+        return move->secondHeading;
+    }
+    return move->heading;
+}
+
+#ifdef MOTION_DIAGONALS
+// Whether every passage of the move, starting from the planned cell, has
+// been sensed this session.
+static int isSensedMove(const PlannerMove* move) {
+    FloodfillCell cell = plannedCell;
+    for (int i = 0; i < move->length; ++i) {
+        if (!Floodfill_isSensedOpen(cell, cellHeading(move, i))) {
+            return 0;
+        }
+        cell = Floodfill_neighbor(cell, cellHeading(move, i));
+    }
+    return 1;
+}
+#endif
+
+// One cell of the route. A passage that has not been sensed, e.g. one only
+// read from a saved map, is driven as a move of its own and answered before
+// anything after it is sent: if it crashes the mouse is still in the cell
+// it started from and nothing queued behind it has run. Either way the
+// answer tells us the wall. Returns 0 on a crash.
+static int addCell(API_Direction heading) {
+    if (Floodfill_isSensedOpen(plannedCell, heading)) {
+        addLeg(2 * heading, 2);
+        plannedCell = Floodfill_neighbor(plannedCell, heading);
+        return 1;
+    }
+    flushLeg();
+    addLeg(2 * heading, 2);
+    flushLeg();
+    if (!API_receiveQueued()) {
+        Floodfill_markWall(plannedCell, heading, 1);
+        return 0;
+    }
+    Floodfill_markWall(plannedCell, heading, 0);
+    plannedCell = Floodfill_neighbor(plannedCell, heading);
+    return 1;
+}
+
+// One planned move, cell by cell. A long enough zig-zag over sensed passages
+// goes as a 45 degree run instead: half a cell out to the first edge, one
+// half step per edge after that, and half a cell in to the centre of the
+// last cell. Returns 0 on a crash.
+static int addMove(const PlannerMove* move) {
+#ifdef MOTION_DIAGONALS
+    if (move->kind == PLANNER_DIAGONAL && move->length >= MOTION_DIAGONAL_MIN_CELLS && isSensedMove(move)) {
+        int first = 2 * move->heading;
+        int second = 2 * move->secondHeading;
+        int last = (move->length % 2 == 1) ? first : second;
+        int between = (second - first + 8) % 8 == 2 ? first + 1 : first + 7;
+        addLeg(first, 1);
+        addLeg(between % 8, move->length - 1);
+        addLeg(last, 1);
+        for (int i = 0; i < move->length; ++i) {
+            plannedCell = Floodfill_neighbor(plannedCell, cellHeading(move, i));
+        }
+        return 1;
+    }
+#endif
+    for (int i = 0; i < move->length; ++i) {
+        if (!addCell(cellHeading(move, i))) {
+            return 0;
+        }
+    }
+    return 1;
+}
+
+void Motion_face(API_Direction heading) {
+    queueTurn(2 * heading - 2 * API_mouseHeading());
+}
+
+int Motion_straight(API_Direction heading, int cells) {
+    Motion_face(heading);
+    API_queueMoveForward(cells);
+    return API_receiveQueued();
+}
+
+void Motion_sendStepAndSense(API_Direction heading) {
+    Motion_face(heading);
+    API_sendMoveForwardAndSense();
+}
+
+int Motion_receiveStepAndSense(int* walls) {
+    return API_receiveMoveForwardAndSense(walls);
+}
+
+// Passages sensed this session go out in one write, as long straightaways
+// and 45 degree runs. Any other passage is driven cell by cell with a round
+// trip each (see addCell), so a crash is only ever a one-cell move and the
+// tracked pose stays exact.
+int Motion_drive(const PlannerMove* moves, int count) {
+    beginPlan();
+    for (int i = 0; i < count; ++i) {
+        if (!addMove(&moves[i])) {
+            return 0;
+        }
+    }
+    flushLeg();
+    return API_receiveQueued();
+}
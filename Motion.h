@@ -0,0 +1,28 @@
+#pragma once
+
+#include "API.h"
+#include "Planner.h"
+
+// Motion primitives above the protocol: straightaways, search turns (a turn
+// sent with the move after it), U-turns and 45 degree runs. Every turn goes
+// out in the same write as the move it leads into, so the mouse never waits
+// on a round trip between stopping, turning and setting off again.
+//
+// Build with -DMOTION_DIAGONALS to drive planned zig-zags as 45 degree runs
+// with turnLeft45/turnRight45 and moveForwardHalf, which only newer mms
+// versions support; otherwise they are driven cell by cell.
+
+// Queues the fewest quarter turns (two for a U-turn) to face heading; they
+// are answered with the next move or query.
+void Motion_face(API_Direction heading);
+// Faces heading and drives cells forward. Returns 0 on a crash.
+int Motion_straight(API_Direction heading, int cells);
+// Motion_straight by one cell followed by a wall sense, split like
+// API_sendMoveForwardAndSense so the caller can work while it is answered.
+void Motion_sendStepAndSense(API_Direction heading);
+int Motion_receiveStepAndSense(int* walls);
+// Drives a planned route from the current cell, merging moves that share a
+// heading. Passages not sensed this session are driven a cell at a time, so
+// after a crash the mouse is in the cell before the wall and the tracked
+// pose still matches. Returns 0 on a crash.
+int Motion_drive(const PlannerMove* moves, int count);
@@ -0,0 +1,312 @@
+#include "Planner.h"
+#include "Stats.h"
+
+#include <limits.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define TURN_NONE 0
+#define TURN_LEFT 1
+#define TURN_RIGHT 2
+#define TURN_KINDS 3
+
+// A search state is a cell, the heading the mouse entered it with, and the
+// kind of turn used to enter it, so that zig-zags can be costed as diagonals.
+#define STATES_PER_CELL (4 * TURN_KINDS)
+
+typedef struct {
+    int cost;
+    int state;
+} HeapEntry;
+
+// Sized by Planner_init. Every state is settled once and pushes at most
+// three successors, plus the four start headings.
+static HeapEntry* heap = NULL;
+static int heapSize = 0;
+static int* stateCost = NULL;
+static int* statePrevious = NULL;
+static unsigned char* stateSettled = NULL;
+static int* pathStates = NULL;
+static int stateCount = 0;
+static int plannerWidth = 0;
+static int maxPathLength = 0;
+
+static void logMessage(const char* text) {
+#ifndef HEADLESS
+    fprintf(stderr, "%s\n", text);
+    fflush(stderr);
+#else
+    (void)text;
+#endif
+}
+
+static void heapPush(int cost, int state) {
+    int index = heapSize++;
+    while (index > 0) {
+        int parent = (index - 1) / 2;
+        if (heap[parent].cost <= cost) {
+            break;
+        }
+        heap[index] = heap[parent];
+        index = parent;
+    }
+    heap[index] = (HeapEntry){cost, state};
+}
+
+static HeapEntry heapPop(void) {
+    HeapEntry top = heap[0];
+    HeapEntry last = heap[--heapSize];
+    int index = 0;
+    while (1) {
+        int child = index * 2 + 1;
+        if (child >= heapSize) {
+            break;
+        }
+        if (child + 1 < heapSize && heap[child + 1].cost < heap[child].cost) {
+            child += 1;
+        }
+        if (heap[child].cost >= last.cost) {
+            break;
+        }
+        heap[index] = heap[child];
+        index = child;
+    }
+    if (heapSize > 0) {
+        heap[index] = last;
+    }
+    return top;
+}
+
+static int encodeState(FloodfillCell cell, API_Direction heading, int turn) {
+    return ((cell.y * plannerWidth + cell.x) * 4 + heading) * TURN_KINDS + turn;
+}
+
+static FloodfillCell stateCell(int state) {
+    int cellIndex = state / STATES_PER_CELL;
+    return (FloodfillCell){cellIndex % plannerWidth, cellIndex / plannerWidth};
+}
+
+static API_Direction stateHeading(int state) {
+    return (API_Direction)((state / TURN_KINDS) % 4);
+}
+
+static int stateTurn(int state) {
+    return state % TURN_KINDS;
+}
+
+static int isGoal(FloodfillCell cell, const FloodfillCell* goals, int goalCount) {
+    for (int i = 0; i < goalCount; ++i) {
+        if (goals[i].x == cell.x && goals[i].y == cell.y) {
+            return 1;
+        }
+    }
+    return 0;
+}
+
+static void relax(int state, int cost, int previous) {
+    if (stateSettled[state] || cost >= stateCost[state]) {
+        return;
+    }
+    stateCost[state] = cost;
+    statePrevious[state] = previous;
+    heapPush(cost, state);
+}
+
+static void expandState(int state, const PlannerWeights* weights) {
+    FloodfillCell cell = stateCell(state);
+    API_Direction heading = stateHeading(state);
+    int turn = stateTurn(state);
+    int baseCost = stateCost[state];
+
+    for (API_Direction dir = API_DIR_NORTH; dir <= API_DIR_WEST; dir = (API_Direction)(dir + 1)) {
+        int diff = (dir - heading + 4) % 4;
+        if (diff == 2 || !Floodfill_isKnownOpen(cell, dir)) {
+            continue;
+        }
+        int nextTurn = TURN_NONE;
+        int stepCost = weights->straight;
+        if (diff != 0) {
+            nextTurn = (diff == 1) ? TURN_RIGHT : TURN_LEFT;
+            int zigZag = (turn == TURN_LEFT && nextTurn == TURN_RIGHT) ||
+                         (turn == TURN_RIGHT && nextTurn == TURN_LEFT);
+            stepCost = zigZag ? weights->diagonal : weights->turn90;
+        }
+        FloodfillCell neighbor = Floodfill_neighbor(cell, dir);
+        relax(encodeState(neighbor, dir, nextTurn), baseCost + stepCost, state);
+    }
+}
+
+static int enteredDiagonally(int state, int previous) {
+    int turn = stateTurn(state);
+    int previousTurn = stateTurn(previous);
+    return (turn == TURN_LEFT && previousTurn == TURN_RIGHT) ||
+           (turn == TURN_RIGHT && previousTurn == TURN_LEFT);
+}
+
+// Turns the settled state chain into straight and diagonal moves. A diagonal
+// starts with the turn that precedes the first zig-zag cell.
+static int emitMoves(int pathLength, PlannerMove* moves, int maxMoves) {
+    int moveCount = 0;
+    int i = 1;
+    while (i < pathLength) {
+        int state = pathStates[i];
+        API_Direction heading = stateHeading(state);
+        if (i + 1 < pathLength && enteredDiagonally(pathStates[i + 1], state)) {
+            int end = i + 1;
+            while (end + 1 < pathLength && enteredDiagonally(pathStates[end + 1], pathStates[end])) {
+                end += 1;
+            }
+            if (moveCount >= maxMoves) {
+                return -1;
+            }
+            moves[moveCount++] = (PlannerMove){
+                PLANNER_DIAGONAL, heading, stateHeading(pathStates[i + 1]), end - i + 1};
+            i = end + 1;
+            continue;
+        }
+        if (moveCount > 0 && moves[moveCount - 1].kind == PLANNER_STRAIGHT &&
+            moves[moveCount - 1].heading == heading) {
+            moves[moveCount - 1].length += 1;
+        } else {
+            if (moveCount >= maxMoves) {
+                return -1;
+            }
+            moves[moveCount++] = (PlannerMove){PLANNER_STRAIGHT, heading, heading, 1};
+        }
+        i += 1;
+    }
+    return moveCount;
+}
+
+static void releaseStorage(void) {
+    free(heap);
+    free(stateCost);
+    free(statePrevious);
+    free(stateSettled);
+    free(pathStates);
+    heap = NULL;
+    stateCost = NULL;
+    statePrevious = NULL;
+    stateSettled = NULL;
+    pathStates = NULL;
+    stateCount = 0;
+}
+
+int Planner_init(void) {
+    releaseStorage();
+    plannerWidth = Floodfill_mazeWidth();
+    maxPathLength = Floodfill_cellCount();
+    if (maxPathLength <= 0) {
+        logMessage("Planner_init called before Floodfill_init");
+        return 0;
+    }
+    stateCount = maxPathLength * STATES_PER_CELL;
+    heap = malloc((size_t)(stateCount * 3 + 4) * sizeof(*heap));
+    stateCost = malloc((size_t)stateCount * sizeof(*stateCost));
+    statePrevious = malloc((size_t)stateCount * sizeof(*statePrevious));
+    stateSettled = malloc((size_t)stateCount * sizeof(*stateSettled));
+    pathStates = malloc((size_t)(maxPathLength + 1) * sizeof(*pathStates));
+    if (heap == NULL || stateCost == NULL || statePrevious == NULL || stateSettled == NULL ||
+        pathStates == NULL) {
+        logMessage("Planner storage allocation failed");
+        releaseStorage();
+        return 0;
+    }
+    return 1;
+}
+
+PlannerWeights Planner_defaultWeights(void) {
+    PlannerWeights weights = {
+        PLANNER_STRAIGHT_COST,
+        PLANNER_TURN90_COST,
+        PLANNER_DIAGONAL_COST,
+        PLANNER_ROTATE_COST,
+    };
+    return weights;
+}
+
+static int plan(FloodfillCell start,
+                API_Direction heading,
+                const FloodfillCell* goals,
+                int goalCount,
+                const PlannerWeights* weights,
+                PlannerMove* moves,
+                int maxMoves) {
+    if (stateCount == 0) {
+        logMessage("Planner used before Planner_init");
+        return -1;
+    }
+    if (start.x < 0 || start.x >= Floodfill_mazeWidth() || start.y < 0 ||
+        start.y >= Floodfill_mazeHeight()) {
+        logMessage("Planner start cell is outside the maze");
+        return -1;
+    }
+    if (isGoal(start, goals, goalCount)) {
+        return 0;
+    }
+
+    for (int i = 0; i < stateCount; ++i) {
+        stateCost[i] = INT_MAX;
+    }
+    memset(stateSettled, 0, (size_t)stateCount);
+    heapSize = 0;
+
+    for (API_Direction dir = API_DIR_NORTH; dir <= API_DIR_WEST; dir = (API_Direction)(dir + 1)) {
+        int diff = (dir - heading + 4) % 4;
+        int rotations = (diff == 2) ? 2 : (diff == 0 ? 0 : 1);
+        relax(encodeState(start, dir, TURN_NONE), rotations * weights->rotate, -1);
+    }
+
+    int goalState = -1;
+    while (heapSize > 0) {
+        HeapEntry entry = heapPop();
+        if (stateSettled[entry.state] || entry.cost != stateCost[entry.state]) {
+            continue;
+        }
+        stateSettled[entry.state] = 1;
+        if (isGoal(stateCell(entry.state), goals, goalCount)) {
+            goalState = entry.state;
+            break;
+        }
+        expandState(entry.state, weights);
+    }
+
+    if (goalState < 0) {
+        logMessage("Planner found no path to goal");
+        return -1;
+    }
+
+    int pathLength = 0;
+    for (int state = goalState; state >= 0; state = statePrevious[state]) {
+        if (pathLength > maxPathLength) {
+            logMessage("Planner path exceeded length limit");
+            return -1;
+        }
+        pathStates[pathLength++] = state;
+    }
+    for (int i = 0; i < pathLength / 2; ++i) {
+        int swap = pathStates[i];
+        pathStates[i] = pathStates[pathLength - 1 - i];
+        pathStates[pathLength - 1 - i] = swap;
+    }
+
+    int moveCount = emitMoves(pathLength, moves, maxMoves);
+    if (moveCount < 0) {
+        logMessage("Planner move buffer overflow");
+    }
+    return moveCount;
+}
+
+int Planner_plan(FloodfillCell start,
+                 API_Direction heading,
+                 const FloodfillCell* goals,
+                 int goalCount,
+                 const PlannerWeights* weights,
+                 PlannerMove* moves,
+                 int maxMoves) {
+    double started = Stats_now();
+    int moveCount = plan(start, heading, goals, goalCount, weights, moves, maxMoves);
+    Stats_addPlan(Stats_now() - started);
+    return moveCount;
+}
@@ -0,0 +1,59 @@
+#pragma once
+
+#include "API.h"
+#include "Floodfill.h"
+
+// Default per-cell costs; override at build time with -D to retune.
+#ifndef PLANNER_STRAIGHT_COST
+#define PLANNER_STRAIGHT_COST 2
+#endif
+#ifndef PLANNER_TURN90_COST
+#define PLANNER_TURN90_COST 6
+#endif
+// Zig-zags only cost less than turning every cell when Motion drives them
+// as 45 degree runs.
+#ifndef PLANNER_DIAGONAL_COST
+#ifdef MOTION_DIAGONALS
+#define PLANNER_DIAGONAL_COST 3
+#else
+#define PLANNER_DIAGONAL_COST PLANNER_TURN90_COST
+#endif
+#endif
+#ifndef PLANNER_ROTATE_COST
+#define PLANNER_ROTATE_COST 8
+#endif
+
+typedef struct {
+    int straight;  // cell entered without changing heading
+    int turn90;    // cell entered through a 90 degree turn
+    int diagonal;  // cell continuing a 45 degree zig-zag
+    int rotate;    // each 90 degrees of in-place rotation before the first cell
+} PlannerWeights;
+
+typedef enum {
+    PLANNER_STRAIGHT = 0,  // length cells along heading
+    PLANNER_DIAGONAL       // length cells alternating heading, secondHeading, ...
+} PlannerMoveKind;
+
+typedef struct {
+    PlannerMoveKind kind;
+    API_Direction heading;
+    API_Direction secondHeading;
+    int length;
+} PlannerMove;
+
+// Sizes the search storage for the maze Floodfill was initialised with.
+// Call after Floodfill_init; returns 0 if allocation failed.
+int Planner_init(void);
+PlannerWeights Planner_defaultWeights(void);
+
+// Time-weighted shortest path from start to any goal through edges a visited
+// cell has seen open. Returns the number of moves written, or -1 if there is
+// no such path or it does not fit in maxMoves.
+int Planner_plan(FloodfillCell start,
+                 API_Direction heading,
+                 const FloodfillCell* goals,
+                 int goalCount,
+                 const PlannerWeights* weights,
+                 PlannerMove* moves,
+                 int maxMoves);
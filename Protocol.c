@@ -0,0 +1,172 @@
+#include "Protocol.h"
+
+#include <errno.h>
+#include <string.h>
+#include <unistd.h>
+
+#define OUTPUT_BUFFER_SIZE 16384
+// A power of two, so positions can run on freely and be masked on use.
+#define RING_SIZE 4096
+#define RING_MASK (RING_SIZE - 1)
+
+static char outputBuffer[OUTPUT_BUFFER_SIZE];
+static int outputLength = 0;
+// Bytes [ringHead, ringTail) are read but not yet parsed. The last line
+// parsed starts at lineStart and stays in place until it is overwritten.
+static char ring[RING_SIZE];
+static unsigned ringHead = 0;
+static unsigned ringTail = 0;
+static unsigned lineStart = 0;
+static unsigned lineLength = 0;
+static int inputClosed = 0;
+
+static void writeAll(const char* data, int length) {
+    while (length > 0) {
+        ssize_t written = write(STDOUT_FILENO, data, length);
+        if (written < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            return;
+        }
+        data += written;
+        length -= (int)written;
+    }
+}
+
+void Protocol_write(const char* text, int length) {
+    if (outputLength + length > OUTPUT_BUFFER_SIZE) {
+        Protocol_flush();
+    }
+    if (length > OUTPUT_BUFFER_SIZE) {
+        writeAll(text, length);
+        return;
+    }
+    memcpy(outputBuffer + outputLength, text, length);
+    outputLength += length;
+}
+
+void Protocol_flush(void) {
+    writeAll(outputBuffer, outputLength);
+    outputLength = 0;
+}
+
+// Reads whatever is available into the free part of the ring, up to its
+// wrap point. Returns 0 at end of input or if the ring is full.
+static int fillRing(void) {
+    unsigned used = ringTail - ringHead;
+    if (inputClosed || used == RING_SIZE) {
+        return 0;
+    }
+    unsigned offset = ringTail & RING_MASK;
+    unsigned space = RING_SIZE - offset;
+    if (space > RING_SIZE - used) {
+        space = RING_SIZE - used;
+    }
+    ssize_t count;
+    do {
+        count = read(STDIN_FILENO, ring + offset, space);
+    } while (count < 0 && errno == EINTR);
+    if (count <= 0) {
+        inputClosed = 1;
+        return 0;
+    }
+    ringTail += (unsigned)count;
+    return 1;
+}
+
+// Consumes the next line, blocking until its newline arrives. If input ends
+// (or a line outgrows the ring) whatever is buffered is taken as the line.
+static void nextLine(void) {
+    unsigned scan = ringHead;
+    while (1) {
+        for (; scan != ringTail; ++scan) {
+            if (ring[scan & RING_MASK] == '\n') {
+                lineStart = ringHead;
+                lineLength = scan - ringHead;
+                ringHead = scan + 1;
+                if (lineLength > 0 && ring[(lineStart + lineLength - 1) & RING_MASK] == '\r') {
+                    lineLength -= 1;
+                }
+                return;
+            }
+        }
+        if (!fillRing()) {
+            lineStart = ringHead;
+            lineLength = ringTail - ringHead;
+            ringHead = ringTail;
+            return;
+        }
+    }
+}
+
+static char lineByte(unsigned index) {
+    return ring[(lineStart + index) & RING_MASK];
+}
+
+static int lineEquals(const char* text, unsigned length) {
+    if (lineLength != length) {
+        return 0;
+    }
+    for (unsigned i = 0; i < length; ++i) {
+        if (lineByte(i) != text[i]) {
+            return 0;
+        }
+    }
+    return 1;
+}
+
+int Protocol_readInteger(void) {
+    nextLine();
+    unsigned i = 0;
+    while (i < lineLength && lineByte(i) == ' ') {
+        i += 1;
+    }
+    int negative = 0;
+    if (i < lineLength && (lineByte(i) == '-' || lineByte(i) == '+')) {
+        negative = lineByte(i) == '-';
+        i += 1;
+    }
+    int value = 0;
+    for (; i < lineLength && lineByte(i) >= '0' && lineByte(i) <= '9'; ++i) {
+        value = value * 10 + (lineByte(i) - '0');
+    }
+    return negative ? -value : value;
+}
+
+int Protocol_readBoolean(void) {
+    nextLine();
+    return lineEquals("true", 4);
+}
+
+int Protocol_readAck(void) {
+    nextLine();
+    return lineEquals("ack", 3);
+}
+
+int Protocol_lastLine(char* out, int size) {
+    int length = (int)lineLength < size - 1 ? (int)lineLength : size - 1;
+    for (int i = 0; i < length; ++i) {
+        out[i] = lineByte(i);
+    }
+    out[length] = '\0';
+    return length;
+}
+
+int Protocol_formatInteger(int value, char* out) {
+    char digits[10];
+    unsigned magnitude = (value < 0) ? 0u - (unsigned)value : (unsigned)value;
+    int count = 0;
+    do {
+        digits[count++] = (char)('0' + magnitude % 10);
+        magnitude /= 10;
+    } while (magnitude != 0);
+    int length = 0;
+    if (value < 0) {
+        out[length++] = '-';
+    }
+    while (count > 0) {
+        out[length++] = digits[--count];
+    }
+    return length;
+}
@@ -0,0 +1,22 @@
+#pragma once
+
+// Simulator protocol I/O on the raw stdin and stdout descriptors, without
+// stdio. Commands collect in an output buffer that each flush hands to a
+// single write(). Responses are read into a ring buffer and parsed where
+// they lie, so one read may hold part of a response or several of them.
+
+// Appends command bytes, flushing first if they do not fit.
+void Protocol_write(const char* text, int length);
+void Protocol_flush(void);
+
+// Each consumes one response line; at end of input the line is empty.
+int Protocol_readInteger(void);  // optional sign then digits, 0 if none
+int Protocol_readBoolean(void);  // 1 for "true"
+int Protocol_readAck(void);      // 1 for "ack"
+// Copies the line last consumed, without its newline, for tracing. Returns
+// its length, truncated to size - 1.
+int Protocol_lastLine(char* out, int size);
+
+// Writes value in decimal to out, which needs room for 11 characters.
+// Returns the number written; no terminator is added.
+int Protocol_formatInteger(int value, char* out);
@@ -0,0 +1,154 @@
+// clock_gettime is POSIX, so ask for it before any header is included; a
+// strict -std=c11 build would otherwise hide it.
+#define _POSIX_C_SOURCE 199309L
+
+#include "Stats.h"
+
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#ifndef CLOCK_MONOTONIC
+#error "Stats needs clock_gettime(CLOCK_MONOTONIC)"
+#endif
+
+#define LABEL_SIZE 16
+
+typedef struct {
+    char label[LABEL_SIZE];
+    double wallSeconds;
+    double readWaitSeconds;
+    long reads;
+    long commands[STATS_COMMAND_KINDS];
+    long bytesWritten;
+    long recalculations;
+    double recalcSeconds;
+    long cellsRelaxed;
+    long plans;
+    double planSeconds;
+} StatsSection;
+
+static StatsSection sections[STATS_MAX_SECTIONS] = {{.label = "startup"}};
+static int sectionCount = 1;
+static StatsSection* current = &sections[0];
+static double sectionStarted = -1.0;
+static FILE* exitReport = NULL;
+
+double Stats_now(void) {
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return now.tv_sec + now.tv_nsec / 1e9;
+}
+
+static void closeSection(void) {
+    double now = Stats_now();
+    if (sectionStarted >= 0.0) {
+        current->wallSeconds += now - sectionStarted;
+    }
+    sectionStarted = now;
+}
+
+void Stats_beginSection(const char* label) {
+    closeSection();
+    for (int i = 0; i < sectionCount; ++i) {
+        if (strncmp(sections[i].label, label, LABEL_SIZE - 1) == 0) {
+            current = &sections[i];
+            return;
+        }
+    }
+    // Once the table is full, later sections share the last slot.
+    if (sectionCount == STATS_MAX_SECTIONS) {
+        current = &sections[STATS_MAX_SECTIONS - 1];
+        snprintf(current->label, LABEL_SIZE, "%s", "other");
+        return;
+    }
+    current = &sections[sectionCount++];
+    snprintf(current->label, LABEL_SIZE, "%s", label);
+}
+
+void Stats_countCommandKind(StatsCommandKind kind, int bytes) {
+    current->commands[kind] += 1;
+    current->bytesWritten += bytes;
+}
+
+void Stats_addReadWait(double seconds) {
+    current->reads += 1;
+    current->readWaitSeconds += seconds;
+}
+
+void Stats_addRecalculation(double seconds) {
+    current->recalculations += 1;
+    current->recalcSeconds += seconds;
+}
+
+void Stats_addCellsRelaxed(long cells) {
+    current->cellsRelaxed += cells;
+}
+
+void Stats_addPlan(double seconds) {
+    current->plans += 1;
+    current->planSeconds += seconds;
+}
+
+static void addSection(StatsSection* total, const StatsSection* section) {
+    total->wallSeconds += section->wallSeconds;
+    total->readWaitSeconds += section->readWaitSeconds;
+    total->reads += section->reads;
+    for (int kind = 0; kind < STATS_COMMAND_KINDS; ++kind) {
+        total->commands[kind] += section->commands[kind];
+    }
+    total->bytesWritten += section->bytesWritten;
+    total->recalculations += section->recalculations;
+    total->recalcSeconds += section->recalcSeconds;
+    total->cellsRelaxed += section->cellsRelaxed;
+    total->plans += section->plans;
+    total->planSeconds += section->planSeconds;
+}
+
+static void printSection(FILE* out, const StatsSection* section) {
+    fprintf(out, "%-10s %9.3f %9.3f %6ld %6ld %6ld %6ld %6ld %6ld %8ld %7ld %9.3f %9ld %5ld %9.3f\n",
+            section->label, section->wallSeconds * 1e3, section->readWaitSeconds * 1e3, section->reads,
+            section->commands[STATS_COMMAND_MOVE], section->commands[STATS_COMMAND_TURN],
+            section->commands[STATS_COMMAND_SENSE], section->commands[STATS_COMMAND_DRAW],
+            section->commands[STATS_COMMAND_OTHER], section->bytesWritten, section->recalculations,
+            section->recalcSeconds * 1e3, section->cellsRelaxed, section->plans, section->planSeconds * 1e3);
+}
+
+void Stats_report(FILE* out) {
+    closeSection();
+    fprintf(out, "%-10s %9s %9s %6s %6s %6s %6s %6s %6s %8s %7s %9s %9s %5s %9s\n", "section", "wall_ms",
+            "wait_ms", "reads", "moves", "turns", "senses", "draws", "other", "bytes", "recalcs", "recalc_ms",
+            "relaxed", "plans", "plan_ms");
+    StatsSection total = {.label = "total"};
+    for (int i = 0; i < sectionCount; ++i) {
+        printSection(out, &sections[i]);
+        addSection(&total, &sections[i]);
+    }
+    printSection(out, &total);
+    fflush(out);
+}
+
+static void reportAtExit(void) {
+    Stats_report(exitReport);
+    if (exitReport != stderr) {
+        fclose(exitReport);
+    }
+}
+
+void Stats_reportAtExit(void) {
+    if (exitReport != NULL) {
+        return;
+    }
+    const char* path = getenv("MMS_PROFILE_FILE");
+    if (path != NULL && path[0] != '\0') {
+        exitReport = fopen(path, "w");
+    }
+#ifndef HEADLESS
+    if (exitReport == NULL) {
+        exitReport = stderr;
+    }
+#endif
+    if (exitReport != NULL) {
+        atexit(reportAtExit);
+    }
+}
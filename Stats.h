@@ -0,0 +1,39 @@
+#pragma once
+
+#include <stdio.h>
+
+// Lightweight run instrumentation. Counters and timers accumulate into the
+// current section (a run phase such as "search" or "fast 2"), so a summary
+// shows whether a slow run is waiting on the simulator, flooding, planning
+// or simply driving.
+
+#define STATS_MAX_SECTIONS 16
+
+typedef enum {
+    STATS_COMMAND_MOVE = 0,  // moveForward, moveForwardHalf
+    STATS_COMMAND_TURN,      // turnLeft, turnRight and their 45 degree forms
+    STATS_COMMAND_SENSE,     // wall queries and wasReset
+    STATS_COMMAND_DRAW,      // walls, colours and text for the display
+    STATS_COMMAND_OTHER,     // maze size, ackReset, anything else
+    STATS_COMMAND_KINDS
+} StatsCommandKind;
+
+// Monotonic seconds, for timing intervals.
+double Stats_now(void);
+
+// Starts accumulating into the section with this label, reusing it if it
+// was seen before. Counts before the first call go to "startup".
+void Stats_beginSection(const char* label);
+
+// Counts a command of this kind, bytes long with its newline.
+void Stats_countCommandKind(StatsCommandKind kind, int bytes);
+void Stats_addReadWait(double seconds);
+void Stats_addRecalculation(double seconds);
+void Stats_addCellsRelaxed(long cells);
+void Stats_addPlan(double seconds);
+
+// Writes one line per section plus a total.
+void Stats_report(FILE* out);
+// Reports at exit to $MMS_PROFILE_FILE when set, otherwise to stderr in
+// builds that log (not HEADLESS).
+void Stats_reportAtExit(void);
@@ -0,0 +1,196 @@
+#include <dirent.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "Maze.h"
+#include "Sim.h"
+
+#define MAX_MAZES 4096
+#define PATH_SIZE 1024
+
+typedef enum {
+    FORMAT_CSV = 0,
+    FORMAT_JSON
+} OutputFormat;
+
+// Counters the solver reports itself when built with -DBENCHMARK.
+typedef struct {
+    long cellsExplored;
+    long searchSteps;
+    long fastPathLength;
+    long recalculations;
+    long fullFloods;
+    long recalcCpuUs;
+} SolverStats;
+
+static void printUsage(const char* program) {
+    fprintf(stderr, "usage: %s [-j] [-n max-commands] <maze-dir> <solver> [solver-args...]\n", program);
+    fprintf(stderr, "The solver must be built with -DBENCHMARK (and usually -DHEADLESS).\n");
+}
+
+static int isMazeFile(const char* name) {
+    static const char* const EXTENSIONS[] = {".maz", ".num", ".txt", ".map"};
+    size_t length = strlen(name);
+    for (size_t i = 0; i < sizeof(EXTENSIONS) / sizeof(EXTENSIONS[0]); ++i) {
+        size_t extensionLength = strlen(EXTENSIONS[i]);
+        if (length > extensionLength && strcmp(name + length - extensionLength, EXTENSIONS[i]) == 0) {
+            return 1;
+        }
+    }
+    return 0;
+}
+
+static int compareNames(const void* a, const void* b) {
+    return strcmp(*(char* const*)a, *(char* const*)b);
+}
+
+static void readSolverStats(const char* path, SolverStats* stats) {
+    stats->cellsExplored = -1;
+    stats->searchSteps = -1;
+    stats->fastPathLength = -1;
+    stats->recalculations = -1;
+    stats->fullFloods = -1;
+    stats->recalcCpuUs = -1;
+    FILE* file = fopen(path, "r");
+    if (file == NULL) {
+        return;
+    }
+    char key[64];
+    long value;
+    while (fscanf(file, " %63[^=]=%ld", key, &value) == 2) {
+        if (strcmp(key, "cells_explored") == 0) {
+            stats->cellsExplored = value;
+        } else if (strcmp(key, "search_steps") == 0) {
+            stats->searchSteps = value;
+        } else if (strcmp(key, "fast_path_length") == 0) {
+            stats->fastPathLength = value;
+        } else if (strcmp(key, "recalculations") == 0) {
+            stats->recalculations = value;
+        } else if (strcmp(key, "full_floods") == 0) {
+            stats->fullFloods = value;
+        } else if (strcmp(key, "recalc_cpu_us") == 0) {
+            stats->recalcCpuUs = value;
+        }
+    }
+    fclose(file);
+}
+
+static double elapsedMs(const struct timespec* start, const struct timespec* end) {
+    return (end->tv_sec - start->tv_sec) * 1e3 + (end->tv_nsec - start->tv_nsec) / 1e6;
+}
+
+static void printRow(OutputFormat format, int first, const char* name, const Maze* maze, int completed,
+                     const SimStats* sim, const SolverStats* solver, double wallMs) {
+    if (format == FORMAT_CSV) {
+        printf("%s,%d,%d,%d,%d,%ld,%ld,%ld,%ld,%ld,%ld,%ld,%ld,%ld,%ld,%ld,%ld,%ld,%.3f\n",
+               name, maze->width, maze->height, completed, sim->reachedGoal, sim->crashes,
+               solver->cellsExplored, solver->searchSteps, solver->fastPathLength, sim->cellsMoved,
+               sim->moveCommands, sim->turns, sim->queries, sim->roundTrips, sim->drawCommands,
+               solver->recalculations, solver->fullFloods, solver->recalcCpuUs, wallMs);
+        return;
+    }
+    printf("%s  {\"maze\": \"%s\", \"width\": %d, \"height\": %d, \"completed\": %d, "
+           "\"reached_goal\": %d, \"crashes\": %ld, \"cells_explored\": %ld, \"search_steps\": %ld, "
+           "\"fast_path_length\": %ld, \"cells_moved\": %ld, \"move_commands\": %ld, \"turns\": %ld, "
+           "\"queries\": %ld, \"round_trips\": %ld, \"draw_commands\": %ld, \"recalculations\": %ld, "
+           "\"full_floods\": %ld, \"recalc_cpu_us\": %ld, \"wall_ms\": %.3f}",
+           first ? "" : ",\n", name, maze->width, maze->height, completed, sim->reachedGoal,
+           sim->crashes, solver->cellsExplored, solver->searchSteps, solver->fastPathLength,
+           sim->cellsMoved, sim->moveCommands, sim->turns, sim->queries, sim->roundTrips,
+           sim->drawCommands, solver->recalculations, solver->fullFloods, solver->recalcCpuUs, wallMs);
+}
+
+int main(int argc, char* argv[]) {
+    OutputFormat format = FORMAT_CSV;
+    SimOptions options = {.maxCommands = 1000000, .quiet = 1};
+    int index = 1;
+    while (index < argc && argv[index][0] == '-') {
+        if (strcmp(argv[index], "-j") == 0) {
+            format = FORMAT_JSON;
+            index += 1;
+        } else if (strcmp(argv[index], "-n") == 0 && index + 1 < argc) {
+            options.maxCommands = atol(argv[index + 1]);
+            index += 2;
+        } else {
+            printUsage(argv[0]);
+            return 2;
+        }
+    }
+    if (argc - index < 2) {
+        printUsage(argv[0]);
+        return 2;
+    }
+    const char* directory = argv[index];
+    char* const* solverArgv = argv + index + 1;
+
+    DIR* dir = opendir(directory);
+    if (dir == NULL) {
+        perror(directory);
+        return 1;
+    }
+    static char* names[MAX_MAZES];
+    int nameCount = 0;
+    struct dirent* entry;
+    while ((entry = readdir(dir)) != NULL && nameCount < MAX_MAZES) {
+        if (isMazeFile(entry->d_name)) {
+            names[nameCount++] = strdup(entry->d_name);
+        }
+    }
+    closedir(dir);
+    qsort(names, nameCount, sizeof(names[0]), compareNames);
+
+    char statsPath[] = "/tmp/mms-bench-XXXXXX";
+    int statsFd = mkstemp(statsPath);
+    if (statsFd < 0) {
+        perror("mkstemp");
+        return 1;
+    }
+    close(statsFd);
+    setenv("MMS_STATS_FILE", statsPath, 1);
+    // Every maze gets a cold start; a saved map from the previous one would
+    // skip its search.
+    setenv("MMS_MAP_FILE", "", 1);
+
+    if (format == FORMAT_CSV) {
+        printf("maze,width,height,completed,reached_goal,crashes,cells_explored,search_steps,"
+               "fast_path_length,cells_moved,move_commands,turns,queries,round_trips,draw_commands,"
+               "recalculations,full_floods,recalc_cpu_us,wall_ms\n");
+    } else {
+        printf("[\n");
+    }
+
+    int failures = 0;
+    int rows = 0;
+    for (int i = 0; i < nameCount; ++i) {
+        char path[PATH_SIZE];
+        snprintf(path, sizeof(path), "%s/%s", directory, names[i]);
+        Maze maze;
+        if (!Maze_load(path, &maze)) {
+            failures += 1;
+            continue;
+        }
+        remove(statsPath);
+        struct timespec started, finished;
+        clock_gettime(CLOCK_MONOTONIC, &started);
+        SimStats sim;
+        int completed = Sim_run(&maze, solverArgv, &options, &sim);
+        clock_gettime(CLOCK_MONOTONIC, &finished);
+        SolverStats solver;
+        readSolverStats(statsPath, &solver);
+        if (!completed) {
+            failures += 1;
+        }
+        printRow(format, rows++ == 0, names[i], &maze, completed, &sim, &solver, elapsedMs(&started, &finished));
+        fflush(stdout);
+        free(names[i]);
+    }
+
+    if (format == FORMAT_JSON) {
+        printf("\n]\n");
+    }
+    remove(statsPath);
+    return failures == 0 ? 0 : 1;
+}
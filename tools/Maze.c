@@ -0,0 +1,204 @@
+#include "Maze.h"
+
+#include <stdio.h>
+#include <string.h>
+
+#define LINE_SIZE 1024
+
+static const unsigned char WALL_BITS[4] = {MAZE_WALL_NORTH, MAZE_WALL_EAST, MAZE_WALL_SOUTH, MAZE_WALL_WEST};
+static const int DELTA_X[4] = {0, 1, 0, -1};
+static const int DELTA_Y[4] = {1, 0, -1, 0};
+
+static void logError(const char* path, const char* text) {
+    fprintf(stderr, "%s: %s\n", path, text);
+}
+
+static int hasExtension(const char* path, const char* extension) {
+    size_t pathLength = strlen(path);
+    size_t extensionLength = strlen(extension);
+    return pathLength >= extensionLength && strcmp(path + pathLength - extensionLength, extension) == 0;
+}
+
+static void setWall(Maze* maze, int x, int y, int direction) {
+    maze->walls[y][x] |= WALL_BITS[direction];
+    int nx = x + DELTA_X[direction];
+    int ny = y + DELTA_Y[direction];
+    if (nx >= 0 && nx < maze->width && ny >= 0 && ny < maze->height) {
+        maze->walls[ny][nx] |= WALL_BITS[(direction + 2) % 4];
+    }
+}
+
+// Mirrors every wall onto the neighbouring cell and closes the outline, so
+// files that only record one side of a wall still load consistently.
+static void normalize(Maze* maze) {
+    for (int y = 0; y < maze->height; ++y) {
+        for (int x = 0; x < maze->width; ++x) {
+            for (int direction = 0; direction < 4; ++direction) {
+                if (maze->walls[y][x] & WALL_BITS[direction]) {
+                    setWall(maze, x, y, direction);
+                }
+            }
+        }
+    }
+    for (int x = 0; x < maze->width; ++x) {
+        setWall(maze, x, 0, 2);
+        setWall(maze, x, maze->height - 1, 0);
+    }
+    for (int y = 0; y < maze->height; ++y) {
+        setWall(maze, 0, y, 3);
+        setWall(maze, maze->width - 1, y, 1);
+    }
+}
+
+static int checkSize(const char* path, int width, int height) {
+    if (width <= 0 || height <= 0 || width > MAZE_MAX_WIDTH || height > MAZE_MAX_HEIGHT) {
+        logError(path, "unsupported maze dimensions");
+        return 0;
+    }
+    return 1;
+}
+
+// .maz: one byte per cell, column-major, bits N=1 E=2 S=4 W=8.
+static int loadMaz(const char* path, FILE* file, Maze* maze) {
+    unsigned char bytes[MAZE_MAX_WIDTH * MAZE_MAX_HEIGHT];
+    size_t count = fread(bytes, 1, sizeof(bytes), file);
+    int side = 0;
+    while ((size_t)((side + 1) * (side + 1)) <= count) {
+        side += 1;
+    }
+    if (side * side != (int)count || !checkSize(path, side, side)) {
+        logError(path, ".maz file is not a square maze");
+        return 0;
+    }
+    maze->width = side;
+    maze->height = side;
+    for (int x = 0; x < side; ++x) {
+        for (int y = 0; y < side; ++y) {
+            maze->walls[y][x] = bytes[x * side + y] & 0x0F;
+        }
+    }
+    return 1;
+}
+
+// .num: "x y north east south west" per line.
+static int loadNum(const char* path, FILE* file, Maze* maze) {
+    char line[LINE_SIZE];
+    while (fgets(line, sizeof(line), file) != NULL) {
+        int x, y, wall[4];
+        if (sscanf(line, "%d %d %d %d %d %d", &x, &y, &wall[0], &wall[1], &wall[2], &wall[3]) != 6) {
+            continue;
+        }
+        if (x < 0 || y < 0 || x >= MAZE_MAX_WIDTH || y >= MAZE_MAX_HEIGHT) {
+            logError(path, "cell outside supported maze size");
+            return 0;
+        }
+        for (int direction = 0; direction < 4; ++direction) {
+            if (wall[direction]) {
+                maze->walls[y][x] |= WALL_BITS[direction];
+            }
+        }
+        if (x + 1 > maze->width) {
+            maze->width = x + 1;
+        }
+        if (y + 1 > maze->height) {
+            maze->height = y + 1;
+        }
+    }
+    return checkSize(path, maze->width, maze->height);
+}
+
+static int isPost(char c) {
+    return c == 'o' || c == '+' || c == '*';
+}
+
+// ASCII map: rows of posts joined by '-' walls, with '|' walls between them.
+static int loadAscii(const char* path, FILE* file, Maze* maze) {
+    static char lines[2 * MAZE_MAX_HEIGHT + 1][LINE_SIZE];
+    int lineCount = 0;
+    while (lineCount < 2 * MAZE_MAX_HEIGHT + 1 && fgets(lines[lineCount], LINE_SIZE, file) != NULL) {
+        lines[lineCount][strcspn(lines[lineCount], "\r\n")] = '\0';
+        if (lines[lineCount][0] != '\0') {
+            lineCount += 1;
+        }
+    }
+    int posts[MAZE_MAX_WIDTH + 1];
+    int postCount = 0;
+    for (int i = 0; lineCount > 0 && lines[0][i] != '\0'; ++i) {
+        if (isPost(lines[0][i])) {
+            if (postCount > MAZE_MAX_WIDTH) {
+                logError(path, "ASCII maze too wide");
+                return 0;
+            }
+            posts[postCount++] = i;
+        }
+    }
+    if (lineCount < 3 || lineCount % 2 == 0 || postCount < 2) {
+        logError(path, "not a recognised ASCII maze");
+        return 0;
+    }
+    maze->width = postCount - 1;
+    maze->height = (lineCount - 1) / 2;
+    if (!checkSize(path, maze->width, maze->height)) {
+        return 0;
+    }
+    for (int row = 0; row < maze->height; ++row) {
+        int y = maze->height - 1 - row;
+        const char* top = lines[2 * row];
+        const char* middle = lines[2 * row + 1];
+        const char* bottom = lines[2 * row + 2];
+        for (int x = 0; x < maze->width; ++x) {
+            int span = posts[x] + 1;
+            if ((int)strlen(top) > span && top[span] != ' ') {
+                maze->walls[y][x] |= MAZE_WALL_NORTH;
+            }
+            if ((int)strlen(bottom) > span && bottom[span] != ' ') {
+                maze->walls[y][x] |= MAZE_WALL_SOUTH;
+            }
+            if ((int)strlen(middle) > posts[x] && middle[posts[x]] != ' ') {
+                maze->walls[y][x] |= MAZE_WALL_WEST;
+            }
+            if ((int)strlen(middle) > posts[x + 1] && middle[posts[x + 1]] != ' ') {
+                maze->walls[y][x] |= MAZE_WALL_EAST;
+            }
+        }
+    }
+    return 1;
+}
+
+int Maze_load(const char* path, Maze* maze) {
+    memset(maze, 0, sizeof(*maze));
+    int binary = hasExtension(path, ".maz");
+    FILE* file = fopen(path, binary ? "rb" : "r");
+    if (file == NULL) {
+        logError(path, "cannot open maze file");
+        return 0;
+    }
+    int loaded;
+    if (binary) {
+        loaded = loadMaz(path, file, maze);
+    } else if (hasExtension(path, ".num")) {
+        loaded = loadNum(path, file, maze);
+    } else {
+        loaded = loadAscii(path, file, maze);
+    }
+    fclose(file);
+    if (loaded) {
+        normalize(maze);
+    }
+    return loaded;
+}
+
+int Maze_hasWall(const Maze* maze, int x, int y, int direction) {
+    if (x < 0 || x >= maze->width || y < 0 || y >= maze->height) {
+        return 1;
+    }
+    return (maze->walls[y][x] & WALL_BITS[direction & 3]) != 0;
+}
+
+int Maze_isGoal(const Maze* maze, int x, int y) {
+    int xLow = (maze->width - 1) / 2;
+    int xHigh = maze->width / 2;
+    int yLow = (maze->height - 1) / 2;
+    int yHigh = maze->height / 2;
+    return (x == xLow || x == xHigh) && (y == yLow || y == yHigh);
+}
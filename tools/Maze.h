@@ -0,0 +1,23 @@
+#pragma once
+
+#define MAZE_MAX_WIDTH 64
+#define MAZE_MAX_HEIGHT 64
+
+#define MAZE_WALL_NORTH 1
+#define MAZE_WALL_EAST 2
+#define MAZE_WALL_SOUTH 4
+#define MAZE_WALL_WEST 8
+
+typedef struct {
+    int width;
+    int height;
+    unsigned char walls[MAZE_MAX_HEIGHT][MAZE_MAX_WIDTH];  // MAZE_WALL_* bits per cell
+} Maze;
+
+// Loads a maze from a .maz (binary, 16x16), .num ("x y n e s w" per line) or
+// ASCII map file, picking the format from the extension and falling back to
+// ASCII. Returns 1 on success, 0 on failure with a message on stderr.
+int Maze_load(const char* path, Maze* maze);
+
+int Maze_hasWall(const Maze* maze, int x, int y, int direction);  // direction 0..3 = n, e, s, w
+int Maze_isGoal(const Maze* maze, int x, int y);
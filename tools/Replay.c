@@ -0,0 +1,186 @@
+#include <signal.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/wait.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "Sim.h"
+
+#define LINE_SIZE 1024
+#define COMMAND_SIZE 256
+
+// One line of an MMS_TRACE_FILE recording.
+typedef struct {
+    char direction;  // '>' command from the solver, '<' response to it
+    long micros;
+    char* text;
+} TraceRecord;
+
+typedef struct {
+    TraceRecord* records;
+    int count;
+    int capacity;
+} Trace;
+
+static void printUsage(const char* program) {
+    fprintf(stderr, "usage: %s [-q] <trace-file> <solver> [solver-args...]\n", program);
+    fprintf(stderr, "Record a trace by running the solver with MMS_TRACE_FILE=<trace-file>.\n");
+}
+
+static void commandName(const char* command, char* name) {
+    if (sscanf(command, "%255s", name) != 1) {
+        name[0] = '\0';
+    }
+}
+
+// Display commands depend on the build (HEADLESS or not) rather than on the
+// run, so they are dropped from both the trace and the live solver.
+static int isDrawLine(const char* command) {
+    char name[COMMAND_SIZE];
+    commandName(command, name);
+    return Sim_isDrawCommand(name);
+}
+
+static int appendRecord(Trace* trace, char direction, long micros, const char* text) {
+    if (trace->count == trace->capacity) {
+        int capacity = trace->capacity ? trace->capacity * 2 : 1024;
+        TraceRecord* records = realloc(trace->records, (size_t)capacity * sizeof(*records));
+        if (records == NULL) {
+            return 0;
+        }
+        trace->records = records;
+        trace->capacity = capacity;
+    }
+    char* copy = strdup(text);
+    if (copy == NULL) {
+        return 0;
+    }
+    trace->records[trace->count++] = (TraceRecord){direction, micros, copy};
+    return 1;
+}
+
+static int loadTrace(const char* path, Trace* trace) {
+    memset(trace, 0, sizeof(*trace));
+    FILE* file = fopen(path, "r");
+    if (file == NULL) {
+        perror(path);
+        return 0;
+    }
+    char line[LINE_SIZE];
+    int ok = 1;
+    while (ok && fgets(line, sizeof(line), file) != NULL) {
+        line[strcspn(line, "\r\n")] = '\0';
+        if (line[0] != '>' && line[0] != '<') {
+            continue;
+        }
+        char* text = NULL;
+        long micros = strtol(line + 1, &text, 10);
+        if (*text == ' ') {
+            text += 1;
+        }
+        if (line[0] == '>' && isDrawLine(text)) {
+            continue;
+        }
+        ok = appendRecord(trace, line[0], micros, text);
+    }
+    fclose(file);
+    if (!ok) {
+        fprintf(stderr, "%s: out of memory\n", path);
+    }
+    return ok;
+}
+
+static double elapsedMs(const struct timespec* start, const struct timespec* end) {
+    return (end->tv_sec - start->tv_sec) * 1e3 + (end->tv_nsec - start->tv_nsec) / 1e6;
+}
+
+int main(int argc, char* argv[]) {
+    int quiet = 0;
+    int index = 1;
+    while (index < argc && argv[index][0] == '-') {
+        if (strcmp(argv[index], "-q") == 0) {
+            quiet = 1;
+            index += 1;
+        } else {
+            printUsage(argv[0]);
+            return 2;
+        }
+    }
+    if (argc - index < 2) {
+        printUsage(argv[0]);
+        return 2;
+    }
+
+    Trace trace;
+    if (!loadTrace(argv[index], &trace)) {
+        return 1;
+    }
+    // The replayed solver must not overwrite the trace it is being fed.
+    unsetenv("MMS_TRACE_FILE");
+
+    signal(SIGPIPE, SIG_IGN);
+    int toFd, fromFd;
+    struct timespec started, finished;
+    clock_gettime(CLOCK_MONOTONIC, &started);
+    pid_t pid = Sim_spawnSolver(argv + index + 1, quiet, &toFd, &fromFd);
+    if (pid < 0) {
+        return 1;
+    }
+    FILE* toSolver = fdopen(toFd, "w");
+    FILE* fromSolver = fdopen(fromFd, "r");
+
+    // Responses are flushed just before the next command is read, so a
+    // pipelined batch is answered with one write, as the simulator would.
+    int next = 0;
+    long commands = 0;
+    long responses = 0;
+    int diverged = 0;
+    char command[COMMAND_SIZE];
+    while (fflush(toSolver) == 0 && fgets(command, sizeof(command), fromSolver) != NULL) {
+        command[strcspn(command, "\r\n")] = '\0';
+        if (isDrawLine(command)) {
+            continue;
+        }
+        if (next >= trace.count || trace.records[next].direction != '>' ||
+            strcmp(trace.records[next].text, command) != 0) {
+            fprintf(stderr, "replay: diverged at command %ld: solver sent \"%s\", trace has \"%s\"\n",
+                    commands + 1, command, next < trace.count ? trace.records[next].text : "(end of trace)");
+            diverged = 1;
+            break;
+        }
+        next += 1;
+        commands += 1;
+        while (next < trace.count && trace.records[next].direction == '<') {
+            fprintf(toSolver, "%s\n", trace.records[next].text);
+            next += 1;
+            responses += 1;
+        }
+    }
+    if (diverged) {
+        kill(pid, SIGKILL);
+    }
+    fclose(toSolver);
+    fclose(fromSolver);
+    int status = 0;
+    waitpid(pid, &status, 0);
+    clock_gettime(CLOCK_MONOTONIC, &finished);
+
+    int complete = !diverged && next == trace.count;
+    if (!diverged && !complete) {
+        fprintf(stderr, "replay: solver stopped with %d trace records left\n", trace.count - next);
+    }
+    printf("trace=%s\n", argv[index]);
+    printf("complete=%d\n", complete);
+    printf("commands=%ld\n", commands);
+    printf("responses=%ld\n", responses);
+    printf("exit_status=%d\n", WIFEXITED(status) ? WEXITSTATUS(status) : -1);
+    printf("recorded_ms=%.3f\n", trace.count > 0 ? trace.records[trace.count - 1].micros / 1e3 : 0.0);
+    printf("replay_ms=%.3f\n", elapsedMs(&started, &finished));
+    for (int i = 0; i < trace.count; ++i) {
+        free(trace.records[i].text);
+    }
+    free(trace.records);
+    return complete ? 0 : 1;
+}
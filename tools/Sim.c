@@ -0,0 +1,352 @@
+#include "Sim.h"
+
+#include <errno.h>
+#include <fcntl.h>
+#include <signal.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/types.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+#define READ_BUFFER_SIZE 65536
+#define WRITE_BUFFER_SIZE 65536
+#define COMMAND_SIZE 256
+
+typedef struct {
+    const Maze* maze;
+    const SimOptions* options;
+    SimStats* stats;
+    int toSolver;
+    int fromSolver;
+    char readBuffer[READ_BUFFER_SIZE];
+    int readStart;
+    int readEnd;
+    char writeBuffer[WRITE_BUFFER_SIZE];
+    int writeLength;
+    // Pose in half cells and eighths of a turn, so that moveForwardHalf and
+    // the 45 degree turns can be followed. Cell centres are at odd
+    // coordinates; heading 0 is north, counting clockwise.
+    int halfX;
+    int halfY;
+    int heading8;
+    // As in mms, a reset only sets a flag for wasReset; the mouse goes back
+    // to the start when the solver sends ackReset.
+    int resetPending;
+    int resetPressed;
+    unsigned char visited[MAZE_MAX_HEIGHT][MAZE_MAX_WIDTH];
+} SimSession;
+
+static const int DELTA_X[8] = {0, 1, 1, 1, 0, -1, -1, -1};
+static const int DELTA_Y[8] = {1, 1, 0, -1, -1, -1, 0, 1};
+
+static void logMessage(const char* text) {
+    fprintf(stderr, "sim: %s\n", text);
+}
+
+static int writeAll(int fd, const char* data, int length) {
+    while (length > 0) {
+        ssize_t written = write(fd, data, length);
+        if (written < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            return 0;
+        }
+        data += written;
+        length -= (int)written;
+    }
+    return 1;
+}
+
+static int flushResponses(SimSession* session) {
+    if (session->writeLength == 0) {
+        return 1;
+    }
+    int ok = writeAll(session->toSolver, session->writeBuffer, session->writeLength);
+    session->writeLength = 0;
+    session->stats->roundTrips += 1;
+    return ok;
+}
+
+static void respond(SimSession* session, const char* text) {
+    int length = (int)strlen(text);
+    if (session->writeLength + length + 1 > WRITE_BUFFER_SIZE) {
+        flushResponses(session);
+    }
+    memcpy(session->writeBuffer + session->writeLength, text, length);
+    session->writeBuffer[session->writeLength + length] = '\n';
+    session->writeLength += length + 1;
+    session->stats->queries += 1;
+}
+
+// Reads one command line from the solver. Answers are only sent once the
+// solver's pending input is used up, so a pipelined batch of queries costs a
+// single round trip. Returns 0 at end of stream.
+static int readCommand(SimSession* session, char* command) {
+    while (1) {
+        for (int i = session->readStart; i < session->readEnd; ++i) {
+            if (session->readBuffer[i] != '\n') {
+                continue;
+            }
+            int length = i - session->readStart;
+            if (length >= COMMAND_SIZE) {
+                length = COMMAND_SIZE - 1;
+            }
+            memcpy(command, session->readBuffer + session->readStart, length);
+            command[length] = '\0';
+            session->readStart = i + 1;
+            return 1;
+        }
+        if (session->readStart > 0) {
+            memmove(session->readBuffer, session->readBuffer + session->readStart,
+                    session->readEnd - session->readStart);
+            session->readEnd -= session->readStart;
+            session->readStart = 0;
+        }
+        if (session->readEnd >= READ_BUFFER_SIZE) {
+            logMessage("command line too long");
+            return 0;
+        }
+        if (!flushResponses(session)) {
+            return 0;
+        }
+        ssize_t count = read(session->fromSolver, session->readBuffer + session->readEnd,
+                             READ_BUFFER_SIZE - session->readEnd);
+        if (count < 0 && errno == EINTR) {
+            continue;
+        }
+        if (count <= 0) {
+            return 0;
+        }
+        session->readEnd += (int)count;
+        session->stats->bytesReceived += count;
+    }
+}
+
+static int wallRelative(SimSession* session, int turn) {
+    int heading = (session->heading8 / 2 + turn) & 3;
+    return Maze_hasWall(session->maze, session->halfX / 2, session->halfY / 2, heading);
+}
+
+static void visit(SimSession* session, int x, int y) {
+    if (!session->visited[y][x]) {
+        session->visited[y][x] = 1;
+        session->stats->cellsVisited += 1;
+    }
+    if (Maze_isGoal(session->maze, x, y)) {
+        session->stats->reachedGoal = 1;
+    }
+}
+
+// Whether the mouse can stand on a half-cell point: always on a cell
+// centre, never on a post, and on an edge only if it is open.
+static int isBlocked(const SimSession* session, int halfX, int halfY) {
+    if ((halfX & 1) && (halfY & 1)) {
+        return 0;
+    }
+    if (!(halfX & 1) && !(halfY & 1)) {
+        return 1;
+    }
+    if (!(halfX & 1)) {
+        return Maze_hasWall(session->maze, halfX / 2 - 1, halfY / 2, 1);
+    }
+    return Maze_hasWall(session->maze, halfX / 2, halfY / 2 - 1, 0);
+}
+
+// Steps half a cell along the heading. Reaching a cell centre, or crossing
+// a cell on a 45 degree heading, enters that cell.
+static int halfStep(SimSession* session) {
+    int nextX = session->halfX + DELTA_X[session->heading8];
+    int nextY = session->halfY + DELTA_Y[session->heading8];
+    if (isBlocked(session, nextX, nextY)) {
+        return 0;
+    }
+    if (((nextX & 1) && (nextY & 1)) || (session->heading8 & 1)) {
+        session->stats->cellsMoved += 1;
+        visit(session, (session->halfX + nextX) / 4, (session->halfY + nextY) / 4);
+    }
+    session->halfX = nextX;
+    session->halfY = nextY;
+    return 1;
+}
+
+// The mouse drives until it has covered halfSteps half cells or hits a
+// wall; a wall ends the move with a crash where the mouse stopped.
+static void moveForward(SimSession* session, int halfSteps) {
+    session->stats->moveCommands += 1;
+    for (int i = 0; i < halfSteps; ++i) {
+        if (!halfStep(session)) {
+            session->stats->crashes += 1;
+            respond(session, "crash");
+            return;
+        }
+    }
+    respond(session, "ack");
+}
+
+static void ackReset(SimSession* session) {
+    if (session->resetPending) {
+        session->resetPending = 0;
+        session->halfX = 1;
+        session->halfY = 1;
+        session->heading8 = 0;
+        session->stats->resets += 1;
+    }
+    respond(session, "ack");
+}
+
+static void turn(SimSession* session, int eighths) {
+    session->heading8 = (session->heading8 + eighths) & 7;
+    session->stats->turns += 1;
+    respond(session, "ack");
+}
+
+int Sim_isDrawCommand(const char* name) {
+    static const char* const DRAW_COMMANDS[] = {
+        "setWall", "clearWall", "setColor", "clearColor", "clearAllColor",
+        "setText", "clearText", "clearAllText",
+    };
+    for (size_t i = 0; i < sizeof(DRAW_COMMANDS) / sizeof(DRAW_COMMANDS[0]); ++i) {
+        if (strcmp(name, DRAW_COMMANDS[i]) == 0) {
+            return 1;
+        }
+    }
+    return 0;
+}
+
+static int handleCommand(SimSession* session, const char* command) {
+    char name[COMMAND_SIZE];
+    int argument = 1;
+    int fields = sscanf(command, "%255s %d", name, &argument);
+    if (fields < 1) {
+        return 1;
+    }
+    char number[16];
+    if (strcmp(name, "mazeWidth") == 0) {
+        snprintf(number, sizeof(number), "%d", session->maze->width);
+        respond(session, number);
+    } else if (strcmp(name, "mazeHeight") == 0) {
+        snprintf(number, sizeof(number), "%d", session->maze->height);
+        respond(session, number);
+    } else if (strcmp(name, "wallFront") == 0) {
+        respond(session, wallRelative(session, 0) ? "true" : "false");
+    } else if (strcmp(name, "wallRight") == 0) {
+        respond(session, wallRelative(session, 1) ? "true" : "false");
+    } else if (strcmp(name, "wallBack") == 0) {
+        respond(session, wallRelative(session, 2) ? "true" : "false");
+    } else if (strcmp(name, "wallLeft") == 0) {
+        respond(session, wallRelative(session, 3) ? "true" : "false");
+    } else if (strcmp(name, "moveForward") == 0) {
+        moveForward(session, 2 * (fields == 2 ? argument : 1));
+    } else if (strcmp(name, "moveForwardHalf") == 0) {
+        moveForward(session, fields == 2 ? argument : 1);
+    } else if (strcmp(name, "turnRight") == 0 || strcmp(name, "turnRight90") == 0) {
+        turn(session, 2);
+    } else if (strcmp(name, "turnLeft") == 0 || strcmp(name, "turnLeft90") == 0) {
+        turn(session, 6);
+    } else if (strcmp(name, "turnRight45") == 0) {
+        turn(session, 1);
+    } else if (strcmp(name, "turnLeft45") == 0) {
+        turn(session, 7);
+    } else if (strcmp(name, "wasReset") == 0) {
+        respond(session, session->resetPending ? "true" : "false");
+    } else if (strcmp(name, "ackReset") == 0) {
+        ackReset(session);
+    } else if (Sim_isDrawCommand(name)) {
+        session->stats->drawCommands += 1;
+    } else {
+        fprintf(stderr, "sim: unsupported command \"%s\"\n", command);
+        return 0;
+    }
+    return 1;
+}
+
+pid_t Sim_spawnSolver(char* const argv[], int quiet, int* toSolver, int* fromSolver) {
+    int input[2];
+    int output[2];
+    if (pipe(input) != 0 || pipe(output) != 0) {
+        logMessage("pipe failed");
+        return -1;
+    }
+    pid_t pid = fork();
+    if (pid < 0) {
+        logMessage("fork failed");
+        return -1;
+    }
+    if (pid == 0) {
+        dup2(input[0], STDIN_FILENO);
+        dup2(output[1], STDOUT_FILENO);
+        close(input[0]);
+        close(input[1]);
+        close(output[0]);
+        close(output[1]);
+        if (quiet) {
+            int devNull = open("/dev/null", O_WRONLY);
+            if (devNull >= 0) {
+                dup2(devNull, STDERR_FILENO);
+                close(devNull);
+            }
+        }
+        execvp(argv[0], argv);
+        perror(argv[0]);
+        _exit(127);
+    }
+    close(input[0]);
+    close(output[1]);
+    *toSolver = input[1];
+    *fromSolver = output[0];
+    return pid;
+}
+
+int Sim_run(const Maze* maze, char* const argv[], const SimOptions* options, SimStats* stats) {
+    static SimSession session;
+    memset(&session, 0, sizeof(session));
+    memset(stats, 0, sizeof(*stats));
+    session.maze = maze;
+    session.options = options;
+    session.stats = stats;
+    session.halfX = 1;
+    session.halfY = 1;
+    visit(&session, 0, 0);
+
+    signal(SIGPIPE, SIG_IGN);
+    pid_t pid = Sim_spawnSolver(argv, options->quiet, &session.toSolver, &session.fromSolver);
+    if (pid < 0) {
+        return 0;
+    }
+
+    int ok = 1;
+    char command[COMMAND_SIZE];
+    while (readCommand(&session, command)) {
+        stats->commands += 1;
+        if (!handleCommand(&session, command)) {
+            ok = 0;
+            break;
+        }
+        if (options->resetAfter > 0 && !session.resetPressed && stats->commands >= options->resetAfter) {
+            session.resetPressed = 1;
+            session.resetPending = 1;
+        }
+        if (options->maxCommands > 0 && stats->commands >= options->maxCommands) {
+            logMessage("command limit reached; stopping solver");
+            ok = 0;
+            break;
+        }
+    }
+    flushResponses(&session);
+    if (!ok) {
+        kill(pid, SIGKILL);
+    }
+    close(session.toSolver);
+    close(session.fromSolver);
+
+    int status = 0;
+    waitpid(pid, &status, 0);
+    stats->exitStatus = WIFEXITED(status) ? WEXITSTATUS(status) : -1;
+    stats->finalX = session.halfX / 2;
+    stats->finalY = session.halfY / 2;
+    stats->finalHeading = session.heading8 / 2;
+    return ok;
+}
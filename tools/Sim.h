@@ -0,0 +1,41 @@
+#pragma once
+
+#include <sys/types.h>
+
+#include "Maze.h"
+
+typedef struct {
+    long maxCommands;  // kill the solver after this many commands; 0 = no limit
+    int quiet;         // discard the solver's stderr
+    long resetAfter;   // press reset once after this many commands; 0 = never
+} SimOptions;
+
+typedef struct {
+    long commands;       // lines received from the solver
+    long queries;        // commands that were answered
+    long roundTrips;     // times the solver waited on a batch of answers
+    long drawCommands;   // setWall, setText, setColor, ...
+    long bytesReceived;
+    long moveCommands;
+    long cellsMoved;
+    long turns;
+    long crashes;
+    long resets;         // resets the solver acknowledged
+    int cellsVisited;
+    int reachedGoal;
+    int finalX;
+    int finalY;
+    int finalHeading;    // 0..3 = n, e, s, w
+    int exitStatus;      // solver exit code, or -1 if it was killed
+} SimStats;
+
+// Runs the solver given by argv (execvp style) against the maze, speaking the
+// mms text protocol over its stdin/stdout. Returns 1 if the solver ran to
+// completion, 0 on a protocol or process error.
+int Sim_run(const Maze* maze, char* const argv[], const SimOptions* options, SimStats* stats);
+
+// Starts the solver with its stdin and stdout on pipes, returning its pid
+// and the pipe ends in *toSolver / *fromSolver, or -1 on failure.
+pid_t Sim_spawnSolver(char* const argv[], int quiet, int* toSolver, int* fromSolver);
+// Output-only display commands, which get no response.
+int Sim_isDrawCommand(const char* name);
@@ -0,0 +1,63 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "Maze.h"
+#include "Sim.h"
+
+static void printUsage(const char* program) {
+    fprintf(stderr, "usage: %s [-q] [-n max-commands] [-r reset-after] <maze-file> <solver> [solver-args...]\n", program);
+}
+
+int main(int argc, char* argv[]) {
+    SimOptions options = {0, 0, 0};
+    int index = 1;
+    while (index < argc && argv[index][0] == '-') {
+        if (strcmp(argv[index], "-q") == 0) {
+            options.quiet = 1;
+            index += 1;
+        } else if (strcmp(argv[index], "-n") == 0 && index + 1 < argc) {
+            options.maxCommands = atol(argv[index + 1]);
+            index += 2;
+        } else if (strcmp(argv[index], "-r") == 0 && index + 1 < argc) {
+            options.resetAfter = atol(argv[index + 1]);
+            index += 2;
+        } else {
+            printUsage(argv[0]);
+            return 2;
+        }
+    }
+    if (argc - index < 2) {
+        printUsage(argv[0]);
+        return 2;
+    }
+
+    Maze maze;
+    if (!Maze_load(argv[index], &maze)) {
+        return 1;
+    }
+
+    SimStats stats;
+    int ok = Sim_run(&maze, argv + index + 1, &options, &stats);
+
+    printf("maze=%s\n", argv[index]);
+    printf("width=%d\n", maze.width);
+    printf("height=%d\n", maze.height);
+    printf("completed=%d\n", ok);
+    printf("exit_status=%d\n", stats.exitStatus);
+    printf("reached_goal=%d\n", stats.reachedGoal);
+    printf("final_x=%d\n", stats.finalX);
+    printf("final_y=%d\n", stats.finalY);
+    printf("cells_moved=%ld\n", stats.cellsMoved);
+    printf("cells_visited=%d\n", stats.cellsVisited);
+    printf("move_commands=%ld\n", stats.moveCommands);
+    printf("turns=%ld\n", stats.turns);
+    printf("crashes=%ld\n", stats.crashes);
+    printf("resets=%ld\n", stats.resets);
+    printf("commands=%ld\n", stats.commands);
+    printf("queries=%ld\n", stats.queries);
+    printf("round_trips=%ld\n", stats.roundTrips);
+    printf("draw_commands=%ld\n", stats.drawCommands);
+    printf("bytes_received=%ld\n", stats.bytesReceived);
+    return ok ? 0 : 1;
+}
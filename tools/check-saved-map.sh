@@ -0,0 +1,42 @@
+#!/bin/sh
+# Regression runs for a saved map that does not match the maze. The map is
+# learned on tools/mazes/saved-map.txt and then used on saved-map-blocked.txt,
+# which is the same maze with one passage on the fast route walled off. Every
+# run must still reach the centre, with and without a simulator reset part
+# way through.
+#
+# usage: tools/check-saved-map.sh <simulator> <solver>
+# with both built as in README.md (the solver with -DHEADLESS).
+
+if [ $# -ne 2 ]; then
+    echo "usage: $0 <simulator> <solver>" >&2
+    exit 2
+fi
+simulator=$1
+solver=$2
+mazes=$(dirname "$0")/mazes
+map=$(mktemp)
+trap 'rm -f "$map"' EXIT
+failed=0
+
+# run <name> <maze> [simulator options...]
+run() {
+    name=$1
+    maze=$2
+    shift 2
+    result=$(MMS_MAP_FILE=$map MMS_FAST_RUNS=2 "$simulator" -q -n 100000 "$@" "$mazes/$maze" "$solver")
+    if echo "$result" | grep -q '^reached_goal=1$'; then
+        echo "ok   $name ($(echo "$result" | grep '^crashes='))"
+    else
+        echo "FAIL $name"
+        echo "$result" | sed 's/^/     /'
+        failed=1
+    fi
+}
+
+for reset in 0 150 400 800; do
+    rm -f "$map"
+    run "learn map (reset after $reset)" saved-map.txt -r "$reset"
+    run "mismatched map (reset after $reset)" saved-map-blocked.txt -r "$reset"
+done
+exit $failed